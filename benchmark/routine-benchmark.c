@@ -0,0 +1,475 @@
+// Times the render and audio callbacks against the branching callbacks
+// they replaced, for every configuration. Built with -DENABLE_BENCHMARK=ON
+// and run on a machine with OBS Studio installed, so libobs finds its
+// graphics module and effects.
+//
+// The transition is the program output and is held at a fixed time with
+// a manual transition. Its scene holds a silent audio input and a
+// pass-through filter, so the numbers are the cost of the callbacks
+// themselves rather than of the sources they render.
+
+#include "../scene-as-transition.c"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#define BENCHMARK_GRAPHICS_MODULE "libobs-d3d11"
+#else
+#define BENCHMARK_GRAPHICS_MODULE "libobs-opengl"
+#endif
+
+#define BENCHMARK_WIDTH 1920
+#define BENCHMARK_HEIGHT 1080
+#define BENCHMARK_SAMPLE_RATE 48000
+#define BENCHMARK_CALLS 200000
+#define BENCHMARK_SETTLE_MS 250
+#define BENCHMARK_SCENE "Benchmark Transition Scene"
+#define BENCHMARK_FILTER "Benchmark Filter"
+
+typedef void (*video_callback_t)(void *data, gs_effect_t *effect);
+typedef bool (*audio_callback_t)(void *data, uint64_t *ts_out,
+				 struct obs_source_audio_mix *audio,
+				 uint32_t mixers, size_t channels,
+				 size_t sample_rate);
+
+// The mix callbacks the baseline kept in the transition data
+static obs_transition_audio_mix_callback_t baseline_mix_a;
+static obs_transition_audio_mix_callback_t baseline_mix_b;
+
+// Copied from the video_render callback before routines were selected
+static void baseline_video_render(void *data, gs_effect_t *effect)
+{
+	struct scene_as_transition *st = data;
+
+	// NULL safety check
+	if (!st || !st->transition_scene) {
+		return;
+	}
+
+	float t = obs_transition_get_time(st->source);
+	bool use_a = t < st->transition_point;
+
+	enum obs_transition_target target = use_a ? OBS_TRANSITION_SOURCE_A
+						  : OBS_TRANSITION_SOURCE_B;
+
+	if (!obs_transition_video_render_direct(st->source, target))
+		return;
+
+	if (t > 0.0f && t < 1.0f) {
+		obs_source_video_render(st->transition_scene);
+	}
+
+	if (use_a) {
+		if (!st->transitioning) {
+			st->transitioning = true;
+			if (obs_source_showing(st->source))
+				obs_source_inc_showing(st->transition_scene);
+			if (obs_source_active(st->source))
+				obs_source_inc_active(st->transition_scene);
+
+			// Lazy load filter if it wasn't available during init
+			if (!st->filter && st->filter_name && st->transition_scene) {
+				const char *no_filter_text = obs_module_text("Filter.NoSelection");
+				bool has_valid_filter = st->filter_name && *st->filter_name &&
+							strcmp(st->filter_name, no_filter_text) != 0 &&
+							strcmp(st->filter_name, "filter") != 0;
+
+				if (has_valid_filter) {
+					st->filter = obs_source_get_filter_by_name(
+						st->transition_scene, st->filter_name);
+					if (st->filter) {
+						blog(LOG_INFO,
+						     "[StreamUP Scene as Transition] Lazy loading succeeded: "
+						     "Found filter '%s' on scene '%s'",
+						     st->filter_name,
+						     obs_source_get_name(st->transition_scene));
+					} else {
+						blog(LOG_WARNING,
+						     "[StreamUP Scene as Transition] Lazy loading failed: "
+						     "Filter '%s' still not found on scene '%s'",
+						     st->filter_name,
+						     obs_source_get_name(st->transition_scene));
+					}
+				}
+			}
+
+			if (st->filter)
+				obs_source_set_enabled(st->filter, true);
+		}
+		obs_source_video_render(st->transition_scene);
+	} else if ((t <= 0.0f || t >= 1.0f) && st->transitioning) {
+		st->transitioning = false;
+		if (obs_source_active(st->source))
+			obs_source_dec_active(st->transition_scene);
+		if (obs_source_showing(st->source))
+			obs_source_dec_showing(st->transition_scene);
+
+		// Disable filter when transition ends
+		if (st->filter)
+			obs_source_set_enabled(st->filter, false);
+	}
+
+	UNUSED_PARAMETER(effect);
+}
+
+// Copied from the audio_render callback before routines were selected
+static bool baseline_audio_render(void *data, uint64_t *ts_out,
+				  struct obs_source_audio_mix *audio,
+				  uint32_t mixers, size_t channels,
+				  size_t sample_rate)
+{
+	struct scene_as_transition *st = data;
+	if (!st || !st->transition_scene)
+		return false;
+
+	uint64_t ts = 0;
+	if (!obs_source_audio_pending(st->transition_scene)) {
+		ts = obs_source_get_audio_timestamp(st->transition_scene);
+		if (!ts)
+			return false;
+	}
+
+	const bool success = obs_transition_audio_render(st->source, ts_out,
+							 audio, mixers,
+							 channels, sample_rate,
+							 baseline_mix_a,
+							 baseline_mix_b);
+	if (!ts || !st->transitioning)
+		return success;
+
+	if (!*ts_out || ts < *ts_out)
+		*ts_out = ts;
+
+	struct obs_source_audio_mix child_audio;
+	obs_source_get_audio_mix(st->transition_scene, &child_audio);
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((mixers & (1 << mix)) == 0)
+			continue;
+
+		for (size_t ch = 0; ch < channels; ch++) {
+			register float *out = audio->output[mix].data[ch];
+			register float *in = child_audio.output[mix].data[ch];
+			register float *end = in + AUDIO_OUTPUT_FRAMES;
+
+			while (in < end)
+				*(out++) += *(in++);
+		}
+	}
+
+	return true;
+}
+
+// The benchmark sources use the source itself as their data
+
+static void *source_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void source_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+// Silent audio input, so the scene has audio that is not pending
+
+static float silence[BENCHMARK_SAMPLE_RATE / 10];
+
+static const char *silence_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Benchmark Silence";
+}
+
+static void silence_video_tick(void *data, float seconds)
+{
+	uint32_t frames = (uint32_t)(seconds * BENCHMARK_SAMPLE_RATE);
+	if (frames > BENCHMARK_SAMPLE_RATE / 10)
+		frames = BENCHMARK_SAMPLE_RATE / 10;
+
+	struct obs_source_audio audio = {
+		.data = {(const uint8_t *)silence},
+		.frames = frames,
+		.speakers = SPEAKERS_MONO,
+		.format = AUDIO_FORMAT_FLOAT,
+		.samples_per_sec = BENCHMARK_SAMPLE_RATE,
+		.timestamp = os_gettime_ns(),
+	};
+	obs_source_output_audio(data, &audio);
+}
+
+static struct obs_source_info benchmark_silence = {
+	.id = "benchmark_silence",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO,
+	.get_name = silence_get_name,
+	.create = source_create,
+	.destroy = source_destroy,
+	.video_tick = silence_video_tick,
+};
+
+// Pass-through filter for the filter and timeline configurations
+
+static const char *pass_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Benchmark Pass-through";
+}
+
+static void pass_video_render(void *data, gs_effect_t *effect)
+{
+	UNUSED_PARAMETER(effect);
+	obs_source_skip_video_filter(data);
+}
+
+static struct obs_source_info benchmark_pass = {
+	.id = "benchmark_pass",
+	.type = OBS_SOURCE_TYPE_FILTER,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = pass_get_name,
+	.create = source_create,
+	.destroy = source_destroy,
+	.video_render = pass_video_render,
+};
+
+static void log_handler(int lvl, const char *msg, va_list args, void *param)
+{
+	UNUSED_PARAMETER(param);
+	if (lvl > LOG_WARNING)
+		return;
+
+	vfprintf(stderr, msg, args);
+	fputc('\n', stderr);
+}
+
+// Starts a manual transition to whichever scene is not showing and holds
+// it at t, then lets the output thread render and tick it so the scene is
+// activated and its audio has been mixed
+static void begin_transition(obs_source_t *transition, obs_source_t *scene_a,
+			     obs_source_t *scene_b, float t)
+{
+	obs_source_t *current = obs_transition_get_active_source(transition);
+	obs_source_t *dest = current == scene_a ? scene_b : scene_a;
+	obs_source_release(current);
+
+	obs_transition_start(transition, OBS_TRANSITION_MODE_MANUAL, 0, dest);
+	obs_transition_set_manual_time(transition, t);
+	os_sleep_ms(BENCHMARK_SETTLE_MS);
+}
+
+// Runs the transition to the end, video_tick then deactivates the scene
+static void end_transition(obs_source_t *transition)
+{
+	obs_transition_set_manual_time(transition, 1.0f);
+	os_sleep_ms(BENCHMARK_SETTLE_MS);
+}
+
+static double time_render(video_callback_t render,
+			  struct scene_as_transition *st,
+			  gs_texrender_t *texrender)
+{
+	obs_enter_graphics();
+	gs_texrender_reset(texrender);
+	gs_texrender_begin(texrender, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+	gs_ortho(0.0f, (float)BENCHMARK_WIDTH, 0.0f, (float)BENCHMARK_HEIGHT,
+		 -100.0f, 100.0f);
+
+	const uint64_t start = os_gettime_ns();
+	for (size_t i = 0; i < BENCHMARK_CALLS; i++)
+		render(st, NULL);
+	const uint64_t elapsed = os_gettime_ns() - start;
+
+	gs_texrender_end(texrender);
+	obs_leave_graphics();
+	return (double)elapsed / BENCHMARK_CALLS;
+}
+
+static double time_audio(audio_callback_t audio_render,
+			 struct scene_as_transition *st,
+			 struct obs_source_audio_mix *audio)
+{
+	const uint64_t start = os_gettime_ns();
+	for (size_t i = 0; i < BENCHMARK_CALLS; i++) {
+		uint64_t ts = 0;
+		audio_render(st, &ts, audio, 1, 2, BENCHMARK_SAMPLE_RATE);
+	}
+	return (double)(os_gettime_ns() - start) / BENCHMARK_CALLS;
+}
+
+static void update_transition(obs_source_t *transition, bool has_filter,
+			      bool has_timeline, bool cross_fade,
+			      bool scene_audio)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_string(settings, "scene", BENCHMARK_SCENE);
+	obs_data_set_string(settings, "filter",
+			    has_filter ? BENCHMARK_FILTER : "filter");
+	obs_data_set_int(settings, "audio_fade_style", cross_fade ? 1 : 0);
+	obs_data_set_double(settings, "audio_volume",
+			    scene_audio ? 100.0 : 0.0);
+
+	obs_data_array_t *events = obs_data_array_create();
+	if (has_timeline) {
+		obs_data_t *item = obs_data_create();
+		obs_data_set_string(item, "value",
+				    "T:" BENCHMARK_FILTER ":toggle@10%");
+		obs_data_array_push_back(events, item);
+		obs_data_release(item);
+	}
+	obs_data_set_array(settings, "filter_events", events);
+	obs_data_array_release(events);
+
+	obs_source_update(transition, settings);
+	obs_data_release(settings);
+
+	baseline_mix_a = cross_fade ? mix_a_cross_fade : mix_a_fade_in_out;
+	baseline_mix_b = cross_fade ? mix_b_cross_fade : mix_b_fade_in_out;
+}
+
+static bool start_obs(void)
+{
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+
+	struct obs_audio_info oai = {
+		.samples_per_sec = BENCHMARK_SAMPLE_RATE,
+		.speakers = SPEAKERS_STEREO,
+	};
+	if (!obs_reset_audio(&oai))
+		return false;
+
+	struct obs_video_info ovi = {
+		.graphics_module = BENCHMARK_GRAPHICS_MODULE,
+		.fps_num = 60,
+		.fps_den = 1,
+		.base_width = BENCHMARK_WIDTH,
+		.base_height = BENCHMARK_HEIGHT,
+		.output_width = BENCHMARK_WIDTH,
+		.output_height = BENCHMARK_HEIGHT,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+	return obs_reset_video(&ovi) == OBS_VIDEO_SUCCESS;
+}
+
+int main(void)
+{
+	base_set_log_handler(log_handler, NULL);
+
+	if (!start_obs()) {
+		fprintf(stderr, "Failed to start libobs\n");
+		obs_shutdown();
+		return 1;
+	}
+
+	obs_register_source(&scene_as_transition);
+	obs_register_source(&benchmark_silence);
+	obs_register_source(&benchmark_pass);
+
+	obs_scene_t *scene = obs_scene_create(BENCHMARK_SCENE);
+	obs_source_t *silence_source = obs_source_create(
+		"benchmark_silence", "Benchmark Silence", NULL, NULL);
+	obs_scene_add(scene, silence_source);
+	obs_source_t *filter = obs_source_create_private(
+		"benchmark_pass", BENCHMARK_FILTER, NULL);
+	obs_source_filter_add(obs_scene_get_source(scene), filter);
+
+	obs_scene_t *scene_a = obs_scene_create("Benchmark A");
+	obs_scene_t *scene_b = obs_scene_create("Benchmark B");
+	obs_source_t *a = obs_scene_get_source(scene_a);
+	obs_source_t *b = obs_scene_get_source(scene_b);
+
+	obs_source_t *transition = obs_source_create(
+		"scene_as_transition", "Benchmark Transition", NULL, NULL);
+	obs_transition_set(transition, a);
+	obs_set_output_source(0, transition);
+
+	struct scene_as_transition *st = obs_obj_get_data(transition);
+
+	obs_enter_graphics();
+	gs_texrender_t *texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	obs_leave_graphics();
+
+	printf("%-34s %12s %12s\n", "video callback", "selected", "baseline");
+
+	for (int has_filter = 0; has_filter < 2; has_filter++) {
+		for (int has_timeline = 0; has_timeline < 2; has_timeline++) {
+			update_transition(transition, has_filter, has_timeline,
+					  false, true);
+
+			// Before and after the transition point
+			for (int half = 0; half < 2; half++) {
+				const float t = half ? 0.75f : 0.25f;
+				begin_transition(transition, a, b, t);
+
+				const double selected = time_render(
+					scene_as_transition_video_render, st,
+					texrender);
+				const double baseline = time_render(
+					baseline_video_render, st, texrender);
+
+				end_transition(transition);
+
+				printf("filter=%d timeline=%d t=%.2f %14.1f ns %9.1f ns\n",
+				       has_filter, has_timeline, t, selected,
+				       baseline);
+			}
+		}
+	}
+
+	obs_enter_graphics();
+	gs_texrender_destroy(texrender);
+	obs_leave_graphics();
+
+	printf("\n%-34s %12s %12s\n", "audio callback", "selected",
+	       "baseline");
+
+	float *buffers = bzalloc(MAX_AUDIO_MIXES * MAX_AUDIO_CHANNELS *
+				 AUDIO_OUTPUT_FRAMES * sizeof(float));
+	struct obs_source_audio_mix audio;
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++)
+			audio.output[mix].data[ch] =
+				buffers + (mix * MAX_AUDIO_CHANNELS + ch) *
+						  AUDIO_OUTPUT_FRAMES;
+	}
+
+	for (int cross_fade = 0; cross_fade < 2; cross_fade++) {
+		for (int scene_audio = 0; scene_audio < 2; scene_audio++) {
+			update_transition(transition, false, false, cross_fade,
+					  scene_audio);
+
+			// Before the transition point, so the scene is active
+			begin_transition(transition, a, b, 0.25f);
+			if (obs_source_audio_pending(st->transition_scene))
+				fprintf(stderr,
+					"Scene audio is pending, mixing is not timed\n");
+
+			const double selected = time_audio(
+				scene_as_transition_audio_render, st, &audio);
+			const double baseline =
+				time_audio(baseline_audio_render, st, &audio);
+
+			end_transition(transition);
+
+			printf("cross_fade=%d scene_audio=%d %19.1f ns %9.1f ns\n",
+			       cross_fade, scene_audio, selected, baseline);
+		}
+	}
+
+	bfree(buffers);
+
+	obs_set_output_source(0, NULL);
+	obs_source_release(transition);
+	obs_scene_release(scene_b);
+	obs_scene_release(scene_a);
+	obs_source_release(filter);
+	obs_source_release(silence_source);
+	obs_scene_release(scene);
+	obs_shutdown();
+	return 0;
+}
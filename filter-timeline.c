@@ -0,0 +1,291 @@
+#include "filter-timeline.h"
+#include <util/platform.h>
+#include <util/dstr.h>
+
+static void free_event_list(struct darray *list)
+{
+	struct filter_event *events = list->array;
+	for (size_t i = 0; i < list->num; i++) {
+		obs_source_release(events[i].filter);
+		bfree(events[i].filter_name);
+	}
+	darray_free(list);
+}
+
+static bool events_equal(const struct darray *a, const struct darray *b)
+{
+	if (a->num != b->num)
+		return false;
+
+	const struct filter_event *ea = a->array;
+	const struct filter_event *eb = b->array;
+	for (size_t i = 0; i < a->num; i++) {
+		if (ea[i].target != eb[i].target || ea[i].action != eb[i].action || ea[i].point != eb[i].point ||
+		    strcmp(ea[i].filter_name, eb[i].filter_name) != 0)
+			return false;
+	}
+	return true;
+}
+
+static void clear_filters(struct filter_timeline *timeline)
+{
+	for (size_t i = 0; i < timeline->events.num; i++) {
+		struct filter_event *event = &timeline->events.array[i];
+		obs_source_release(event->filter);
+		event->filter = NULL;
+	}
+	timeline->cursor = 0;
+	timeline->armed = false;
+
+	if (timeline->has_pending) {
+		free_event_list(&timeline->events.da);
+		timeline->events.da = timeline->pending.da;
+		da_init(timeline->pending);
+		timeline->has_pending = false;
+	}
+}
+
+static void free_events(struct filter_timeline *timeline)
+{
+	clear_filters(timeline);
+	free_event_list(&timeline->events.da);
+}
+
+void filter_timeline_init(struct filter_timeline *timeline)
+{
+	memset(timeline, 0, sizeof(*timeline));
+	pthread_mutex_init(&timeline->mutex, NULL);
+}
+
+void filter_timeline_free(struct filter_timeline *timeline)
+{
+	free_events(timeline);
+	free_event_list(&timeline->pending.da);
+	pthread_mutex_destroy(&timeline->mutex);
+}
+
+static bool parse_action(const char *text, enum filter_event_action *action)
+{
+	if (astrcmpi(text, "enable") == 0 || astrcmpi(text, "on") == 0)
+		*action = FILTER_ACTION_ENABLE;
+	else if (astrcmpi(text, "disable") == 0 || astrcmpi(text, "off") == 0)
+		*action = FILTER_ACTION_DISABLE;
+	else if (astrcmpi(text, "toggle") == 0)
+		*action = FILTER_ACTION_TOGGLE;
+	else
+		return false;
+	return true;
+}
+
+static bool parse_target(const char *text, enum filter_event_target *target)
+{
+	if (astrcmpi(text, "T") == 0)
+		*target = FILTER_TARGET_SCENE;
+	else if (astrcmpi(text, "A") == 0)
+		*target = FILTER_TARGET_A;
+	else if (astrcmpi(text, "B") == 0)
+		*target = FILTER_TARGET_B;
+	else
+		return false;
+	return true;
+}
+
+static bool parse_event(const char *value, struct filter_event *event)
+{
+	struct dstr name = {0};
+	struct dstr part = {0};
+	bool success = false;
+
+	const char *at = strrchr(value, '@');
+	if (!at)
+		goto done;
+
+	dstr_copy(&part, at + 1);
+	dstr_depad(&part);
+	if (dstr_is_empty(&part))
+		goto done;
+	event->time = (float)os_strtod(part.array);
+	event->time_ms = part.len > 2 && astrcmpi(part.array + part.len - 2, "ms") == 0;
+
+	dstr_ncopy(&name, value, at - value);
+	if (dstr_is_empty(&name))
+		goto done;
+
+	char *colon = strrchr(name.array, ':');
+	if (!colon)
+		goto done;
+
+	dstr_copy(&part, colon + 1);
+	dstr_depad(&part);
+	if (dstr_is_empty(&part) || !parse_action(part.array, &event->action))
+		goto done;
+	dstr_resize(&name, colon - name.array);
+
+	event->target = FILTER_TARGET_SCENE;
+	colon = strchr(name.array, ':');
+	if (colon) {
+		dstr_ncopy(&part, name.array, colon - name.array);
+		dstr_depad(&part);
+		if (!dstr_is_empty(&part) && parse_target(part.array, &event->target)) {
+			dstr_copy(&part, colon + 1);
+			dstr_copy(&name, part.array);
+		}
+	}
+
+	dstr_depad(&name);
+	if (dstr_is_empty(&name))
+		goto done;
+
+	event->filter_name = bstrdup(name.array);
+	success = true;
+
+done:
+	if (!success)
+		blog(LOG_WARNING, "[StreamUP Scene as Transition] Ignoring invalid filter event '%s'", value);
+	dstr_free(&part);
+	dstr_free(&name);
+	return success;
+}
+
+void filter_timeline_update(struct filter_timeline *timeline, obs_data_array_t *list, float duration)
+{
+	DARRAY(struct filter_event) events;
+	da_init(events);
+
+	const size_t count = obs_data_array_count(list);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(list, i);
+		struct filter_event event = {0};
+
+		if (parse_event(obs_data_get_string(item, "value"), &event)) {
+			if (event.time_ms)
+				event.point = duration > 0.0f ? event.time / duration : 0.0f;
+			else
+				event.point = event.time / 100.0f;
+
+			if (event.point < 0.0f)
+				event.point = 0.0f;
+			else if (event.point > 1.0f)
+				event.point = 1.0f;
+
+			// Keep the timeline sorted, events at the same point fire
+			// in list order
+			size_t idx = events.num;
+			while (idx > 0 && events.array[idx - 1].point > event.point)
+				idx--;
+			da_insert(events, idx, &event);
+		}
+
+		obs_data_release(item);
+	}
+
+	pthread_mutex_lock(&timeline->mutex);
+	if (events_equal(&events.da, &timeline->events.da)) {
+		// Drops a change that was reverted before it took effect
+		free_event_list(&events.da);
+		if (timeline->has_pending) {
+			free_event_list(&timeline->pending.da);
+			timeline->has_pending = false;
+		}
+	} else if (timeline->armed) {
+		// Filters fired so far are only restored and released by the
+		// events they came from
+		free_event_list(&timeline->pending.da);
+		timeline->pending.da = events.da;
+		timeline->has_pending = true;
+	} else {
+		free_events(timeline);
+		timeline->events.da = events.da;
+	}
+	pthread_mutex_unlock(&timeline->mutex);
+}
+
+void filter_timeline_arm(struct filter_timeline *timeline, obs_source_t *const targets[FILTER_TARGET_COUNT])
+{
+	pthread_mutex_lock(&timeline->mutex);
+	clear_filters(timeline);
+
+	for (size_t i = 0; i < timeline->events.num; i++) {
+		struct filter_event *event = &timeline->events.array[i];
+		obs_source_t *target = targets[event->target];
+		if (target)
+			event->filter = obs_source_get_filter_by_name(target, event->filter_name);
+	}
+
+	timeline->armed = true;
+	pthread_mutex_unlock(&timeline->mutex);
+}
+
+static void fire_event(struct filter_event *event)
+{
+	if (!event->filter)
+		return;
+
+	event->was_enabled = obs_source_enabled(event->filter);
+
+	switch (event->action) {
+	case FILTER_ACTION_ENABLE:
+		obs_source_set_enabled(event->filter, true);
+		break;
+	case FILTER_ACTION_DISABLE:
+		obs_source_set_enabled(event->filter, false);
+		break;
+	case FILTER_ACTION_TOGGLE:
+		obs_source_set_enabled(event->filter, !event->was_enabled);
+		break;
+	}
+}
+
+void filter_timeline_advance(struct filter_timeline *timeline, float t)
+{
+	pthread_mutex_lock(&timeline->mutex);
+	while (timeline->armed && timeline->cursor < timeline->events.num) {
+		struct filter_event *event = &timeline->events.array[timeline->cursor];
+		if (event->point > t)
+			break;
+
+		fire_event(event);
+		timeline->cursor++;
+	}
+	pthread_mutex_unlock(&timeline->mutex);
+}
+
+// Must be called with the mutex held
+static void rewind_events(struct filter_timeline *timeline, float t, bool all)
+{
+	while (timeline->armed && timeline->cursor > 0) {
+		struct filter_event *event = &timeline->events.array[timeline->cursor - 1];
+		if (!all && event->point <= t)
+			break;
+
+		if (event->filter)
+			obs_source_set_enabled(event->filter, event->was_enabled);
+		timeline->cursor--;
+	}
+}
+
+void filter_timeline_rewind(struct filter_timeline *timeline, float t)
+{
+	pthread_mutex_lock(&timeline->mutex);
+	rewind_events(timeline, t, false);
+	pthread_mutex_unlock(&timeline->mutex);
+}
+
+void filter_timeline_finish(struct filter_timeline *timeline)
+{
+	pthread_mutex_lock(&timeline->mutex);
+	if (timeline->armed) {
+		while (timeline->cursor < timeline->events.num)
+			fire_event(&timeline->events.array[timeline->cursor++]);
+	}
+	clear_filters(timeline);
+	pthread_mutex_unlock(&timeline->mutex);
+}
+
+void filter_timeline_cancel(struct filter_timeline *timeline)
+{
+	pthread_mutex_lock(&timeline->mutex);
+	rewind_events(timeline, 0.0f, true);
+	clear_filters(timeline);
+	pthread_mutex_unlock(&timeline->mutex);
+}
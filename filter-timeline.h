@@ -0,0 +1,78 @@
+#pragma once
+
+#include "obs-module.h"
+#include <util/darray.h>
+#include <util/threading.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum filter_event_target {
+	FILTER_TARGET_SCENE,
+	FILTER_TARGET_A,
+	FILTER_TARGET_B,
+	FILTER_TARGET_COUNT,
+};
+
+enum filter_event_action {
+	FILTER_ACTION_ENABLE,
+	FILTER_ACTION_DISABLE,
+	FILTER_ACTION_TOGGLE,
+};
+
+struct filter_event {
+	enum filter_event_target target;
+	enum filter_event_action action;
+	char *filter_name;
+	float time;
+	bool time_ms;
+	// Position in the transition from 0 to 1, the timeline is sorted on it
+	float point;
+
+	// Only set while the timeline is armed
+	obs_source_t *filter;
+	bool was_enabled;
+};
+
+struct filter_timeline {
+	pthread_mutex_t mutex;
+	DARRAY(struct filter_event) events;
+	size_t cursor;
+	bool armed;
+
+	// List changed while armed, swapped in once the transition is over
+	DARRAY(struct filter_event) pending;
+	bool has_pending;
+};
+
+void filter_timeline_init(struct filter_timeline *timeline);
+void filter_timeline_free(struct filter_timeline *timeline);
+
+// Rebuilds the timeline from the editable list in the settings. Entries are
+// "[T|A|B:]filter:enable|disable|toggle@10%" or "...@700ms". Nothing changes
+// when the list is the same, and a changed list only takes effect once the
+// running transition has finished.
+void filter_timeline_update(struct filter_timeline *timeline, obs_data_array_t *list, float duration);
+
+// Resolves the filters on the scene and sources A and B once per transition
+// and rewinds the cursor
+void filter_timeline_arm(struct filter_timeline *timeline, obs_source_t *const targets[FILTER_TARGET_COUNT]);
+
+// Fires every event up to t, costs nothing when no event is due
+void filter_timeline_advance(struct filter_timeline *timeline, float t);
+
+// Undoes the events after t, restoring the state each filter had before it
+// fired. Only needed when t can move backwards, e.g. while scrubbing.
+void filter_timeline_rewind(struct filter_timeline *timeline, float t);
+
+// Fires the events that were not reached and releases the filters
+void filter_timeline_finish(struct filter_timeline *timeline);
+
+// Undoes every event that fired and releases the filters, for transitions
+// that were pulled back to the start
+void filter_timeline_cancel(struct filter_timeline *timeline);
+
+#ifdef __cplusplus
+}
+#endif
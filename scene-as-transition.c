@@ -1,7 +1,12 @@
 #include "obs-module.h"
 #include "version.h"
+#include "stinger-analysis.h"
+#include "filter-timeline.h"
+#include "websocket-vendor.h"
 #include <util/platform.h>
 #include <util/dstr.h>
+#include <util/darray.h>
+#include <util/threading.h>
 #include <obs-frontend-api.h>
 
 #ifdef _WIN32
@@ -12,17 +17,95 @@
 #define LOG_OFFSET_DB 6.0f
 #define LOG_RANGE_DB 96.0f
 
+#define PREARM_DEFAULT_TIMEOUT_MS 10000
+
+// Scrubbing ends this long after the last T-bar movement
+#define SCRUB_HOLD_NS 500000000ULL
+// Distance from the transition point t has to move past before switching
+// between A and B while scrubbing
+#define SCRUB_HYSTERESIS 0.02f
+
+enum pool_mode {
+	POOL_MODE_ROUND_ROBIN,
+	POOL_MODE_RANDOM,
+	POOL_MODE_WEIGHTED,
+};
+
+struct pool_entry {
+	obs_source_t *scene;
+	float weight;
+	bool warm;
+};
+
+struct transition_stats {
+	uint64_t transitions;
+	uint64_t last_activation_ns;
+	uint64_t last_render_ns;
+	uint64_t max_render_ns;
+	uint64_t total_render_ns;
+	uint64_t rendered_frames;
+	uint64_t dropped_frames;
+	uint64_t last_dropped_frames;
+	uint64_t last_frame_ts;
+};
+
 struct scene_as_transition {
 	obs_source_t *source;
+	// Current pick, owned by the pool
 	obs_source_t *transition_scene;
+
+	pthread_mutex_t pool_mutex;
+	DARRAY(struct pool_entry) pool;
+	DARRAY(size_t) upcoming;
+	size_t pool_index;
+	enum pool_mode pool_mode;
+	uint64_t pool_budget;
+	// Pick that was removed from the pool while it played, released once
+	// its transition has finished
+	obs_source_t *retired_scene;
 	obs_source_t *filter;
 	bool transitioning;
+	// Set between activating the scene and deactivating it again, unlike
+	// transitioning which update also sets
+	bool scene_active;
 	float transition_point;
 	float duration;
 	char *filter_name;
 
-	obs_transition_audio_mix_callback_t mix_a;
-	obs_transition_audio_mix_callback_t mix_b;
+	bool tp_auto;
+	bool tp_detect_pending;
+
+	struct filter_timeline timeline;
+	volatile bool timeline_restart;
+
+	// Pre-arming is requested from any thread and done in video_tick
+	volatile bool prearm_requested;
+	volatile bool disarm_requested;
+	uint64_t prearm_timeout_ns;
+	uint64_t prearm_deadline;
+	obs_source_t *prearmed_scene;
+
+	// T-bar scrubbing. tbar_event_ns is set on the UI thread, the rest is
+	// only used on the graphics thread.
+	volatile uint64_t tbar_event_ns;
+	bool scrubbing;
+	bool scrub_use_a;
+	int64_t scrub_seek_ms;
+	DARRAY(obs_source_t *) scrub_media;
+
+	// Written on the graphics thread, read without locking
+	struct transition_stats stats;
+	uint64_t frame_interval_ns;
+
+	bool filter_valid;
+
+	// Picked in update for the current configuration
+	void (*render)(struct scene_as_transition *st, float t);
+	bool (*audio_render)(struct scene_as_transition *st, uint64_t *ts_out,
+			     struct obs_source_audio_mix *audio,
+			     uint32_t mixers, size_t channels,
+			     size_t sample_rate);
+
 	float transition_a_mul;
 	float transition_b_mul;
 };
@@ -63,32 +146,583 @@ static float mix_b_cross_fade(void *data, float t)
 	return t;
 }
 
+typedef void (*scene_source_proc_t)(obs_source_t *source, void *param);
+
+struct scene_walk {
+	scene_source_proc_t callback;
+	void *param;
+};
+
+static bool scene_walk_item(obs_scene_t *scene, obs_sceneitem_t *item,
+			    void *param)
+{
+	UNUSED_PARAMETER(scene);
+	struct scene_walk *walk = param;
+	obs_source_t *source = obs_sceneitem_get_source(item);
+
+	obs_scene_t *nested = obs_scene_from_source(source);
+	if (!nested)
+		nested = obs_group_from_source(source);
+	if (nested)
+		obs_scene_enum_items(nested, scene_walk_item, walk);
+	else
+		walk->callback(source, walk->param);
+	return true;
+}
+
+// Calls back for every source in the scene, including the ones in nested
+// scenes and groups
+static void enum_scene_sources(obs_source_t *scene_source,
+			       scene_source_proc_t callback, void *param)
+{
+	obs_scene_t *scene = obs_scene_from_source(scene_source);
+	if (!scene)
+		return;
+
+	struct scene_walk walk = {callback, param};
+	obs_scene_enum_items(scene, scene_walk_item, &walk);
+}
+
+struct stinger_media_list {
+	DARRAY(char *) paths;
+};
+
+static void collect_stinger_media(obs_source_t *source, void *param)
+{
+	struct stinger_media_list *list = param;
+
+	if (strcmp(obs_source_get_unversioned_id(source), "ffmpeg_source") != 0)
+		return;
+
+	obs_data_t *settings = obs_source_get_settings(source);
+	const char *file = obs_data_get_string(settings, "local_file");
+	if (obs_data_get_bool(settings, "is_local_file") && *file) {
+		char *path = bstrdup(file);
+		da_push_back(list->paths, &path);
+	}
+	obs_data_release(settings);
+}
+
+static void stinger_analysis_finished(void *param, bool success);
+
+enum detect_status {
+	DETECT_NONE,
+	DETECT_PENDING,
+	DETECT_FOUND,
+};
+
+// Picks the analysed media with the best alpha coverage in the transition
+// scene. Only reads the cache; files that are not cached yet are queued
+// for analysis when queue_missing is set.
+static enum detect_status
+scene_as_transition_detect_point(struct scene_as_transition *st,
+				 bool queue_missing,
+				 struct stinger_analysis *best)
+{
+	if (!obs_scene_from_source(st->transition_scene))
+		return DETECT_NONE;
+
+	struct stinger_media_list list;
+	da_init(list.paths);
+	enum_scene_sources(st->transition_scene, collect_stinger_media, &list);
+
+	bool pending = false;
+	bool found = false;
+	for (size_t i = 0; i < list.paths.num; i++) {
+		const char *path = list.paths.array[i];
+		struct stinger_analysis result;
+
+		if (!stinger_analysis_lookup(path, &result)) {
+			// Nothing to wait for when the file is gone or the
+			// plugin was built without FFmpeg
+			if (stinger_analysis_available() &&
+			    os_file_exists(path)) {
+				pending = true;
+				if (queue_missing)
+					stinger_analysis_queue(
+						path, stinger_analysis_finished,
+						obs_source_get_weak_source(
+							st->source));
+			}
+		} else if (result.has_alpha &&
+			   (!found ||
+			    result.peak_coverage > best->peak_coverage ||
+			    (result.peak_coverage == best->peak_coverage &&
+			     result.duration_ms > best->duration_ms))) {
+			*best = result;
+			found = true;
+		}
+		bfree(list.paths.array[i]);
+	}
+	da_free(list.paths);
+
+	if (found)
+		return DETECT_FOUND;
+	return pending ? DETECT_PENDING : DETECT_NONE;
+}
+
+// The fade multipliers depend on the transition point, so it is only set
+// through here
+static void scene_as_transition_set_point(struct scene_as_transition *st,
+					  float point)
+{
+	st->transition_point = point;
+	st->transition_a_mul = (1.0f / point);
+	st->transition_b_mul = (1.0f / (1.0f - point));
+}
+
+// Detected points are kept off the very ends so both halves still play
+static float detected_point(const struct scene_as_transition *st,
+			    const struct stinger_analysis *detected)
+{
+	float point = (float)detected->peak_ms / st->duration;
+	return point < 0.01f ? 0.01f : point > 0.99f ? 0.99f : point;
+}
+
+// Follows the stinger media of the current pick when the transition point
+// is detected automatically
+static void
+scene_as_transition_refresh_auto_point(struct scene_as_transition *st,
+				       bool queue_missing)
+{
+	if (!st->tp_auto || st->duration <= 0.0f)
+		return;
+
+	struct stinger_analysis detected;
+	if (scene_as_transition_detect_point(st, queue_missing, &detected) ==
+	    DETECT_FOUND)
+		scene_as_transition_set_point(st, detected_point(st, &detected));
+}
+
+// Transition point set in the properties, as a fraction of the duration
+static float settings_transition_point(const struct scene_as_transition *st,
+				       obs_data_t *settings)
+{
+	if (obs_data_get_int(settings, "tp_type") == 1) {
+		const float transition_point_ms = (float)obs_data_get_double(
+			settings, "transition_point_ms");
+		return st->duration > 0.0f ? transition_point_ms / st->duration
+					   : st->transition_point;
+	}
+	return (float)obs_data_get_double(settings, "transition_point") /
+	       100.0f;
+}
+
+// Fills in the point requested with the detect button once the analysis is
+// available. Returns true when the settings were changed.
+static bool scene_as_transition_suggest_point(
+	struct scene_as_transition *st, obs_data_t *settings,
+	enum detect_status status, const struct stinger_analysis *detected)
+{
+	if (!st->tp_detect_pending)
+		return false;
+	if (status != DETECT_PENDING)
+		st->tp_detect_pending = false;
+	if (status != DETECT_FOUND || st->duration <= 0.0f)
+		return false;
+
+	// Same range as the automatic point, media longer than the transition
+	// would otherwise end up past the end of the slider
+	const float point = detected_point(st, detected);
+	obs_data_set_double(settings, "transition_point", point * 100.0);
+	obs_data_set_double(settings, "transition_point_ms",
+			    point * st->duration);
+	return true;
+}
+
+// Applies a pending detect button request without running the rest of
+// update
+static void scene_as_transition_apply_suggestion(struct scene_as_transition *st,
+						 bool queue_missing)
+{
+	if (!st->tp_detect_pending)
+		return;
+
+	struct stinger_analysis detected;
+	enum detect_status status =
+		scene_as_transition_detect_point(st, queue_missing, &detected);
+
+	obs_data_t *settings = obs_source_get_settings(st->source);
+	if (scene_as_transition_suggest_point(st, settings, status,
+					      &detected) &&
+	    !st->tp_auto)
+		scene_as_transition_set_point(
+			st, settings_transition_point(st, settings));
+	obs_data_release(settings);
+}
+
+static void stinger_analysis_finished_task(void *param)
+{
+	obs_weak_source_t *weak = param;
+	obs_source_t *source = obs_weak_source_get_source(weak);
+	obs_weak_source_release(weak);
+	if (!source)
+		return;
+
+	// Only the transition point depends on the analysis
+	struct scene_as_transition *st = obs_obj_get_data(source);
+	scene_as_transition_apply_suggestion(st, false);
+	scene_as_transition_refresh_auto_point(st, false);
+
+	obs_source_release(source);
+}
+
+static void stinger_analysis_finished(void *param, bool success)
+{
+	if (success)
+		obs_queue_task(OBS_TASK_UI, stinger_analysis_finished_task,
+			       param, false);
+	else
+		obs_weak_source_release(param);
+}
+
+static size_t pool_pick(struct scene_as_transition *st, size_t previous)
+{
+	const size_t count = st->pool.num;
+	if (count < 2)
+		return 0;
+
+	switch (st->pool_mode) {
+	case POOL_MODE_RANDOM: {
+		if (previous >= count)
+			return (size_t)rand() % count;
+
+		// Never play the same scene twice in a row
+		size_t index = (size_t)rand() % (count - 1);
+		return index >= previous ? index + 1 : index;
+	}
+	case POOL_MODE_WEIGHTED: {
+		float total = 0.0f;
+		for (size_t i = 0; i < count; i++)
+			total += st->pool.array[i].weight;
+
+		float r = (float)rand() / (float)RAND_MAX * total;
+		for (size_t i = 0; i < count; i++) {
+			r -= st->pool.array[i].weight;
+			if (r <= 0.0f)
+				return i;
+		}
+		return count - 1;
+	}
+	default:
+		return (previous + 1) % count;
+	}
+}
+
+// Must be called with pool_mutex held
+static void pool_fill_upcoming(struct scene_as_transition *st)
+{
+	size_t last = st->upcoming.num
+			      ? st->upcoming.array[st->upcoming.num - 1]
+			      : st->pool_index;
+
+	while (st->upcoming.num < st->pool.num) {
+		last = pool_pick(st, last);
+		da_push_back(st->upcoming, &last);
+	}
+}
+
+static void add_source_size(obs_source_t *source, void *param)
+{
+	uint64_t *bytes = param;
+
+	uint64_t width = obs_source_get_width(source);
+	uint64_t height = obs_source_get_height(source);
+
+	// Media that has not been opened yet reports no size
+	if (!width || !height) {
+		struct obs_video_info ovi;
+		if (obs_get_video_info(&ovi)) {
+			width = ovi.base_width;
+			height = ovi.base_height;
+		}
+	}
+
+	*bytes += width * height * 4;
+}
+
+// Rough estimate of the texture memory a scene holds while it is shown
+static uint64_t estimate_scene_memory(obs_source_t *scene_source)
+{
+	uint64_t bytes = (uint64_t)obs_source_get_width(scene_source) *
+			 obs_source_get_height(scene_source) * 4;
+
+	enum_scene_sources(scene_source, add_source_size, &bytes);
+	return bytes;
+}
+
+// Keeps the next picks shown, as many as fit the memory budget, so browser
+// and media sources in them are loaded before their transition starts.
+// Entries are only added or removed on the UI thread, the render thread
+// just moves through upcoming.
+static void pool_update_warm_set(struct scene_as_transition *st)
+{
+	if (!st->pool.num)
+		return;
+
+	// The pick that plays next comes first, so the budget never evicts it
+	// in favour of a later one
+	pthread_mutex_lock(&st->pool_mutex);
+	size_t count = st->upcoming.num + 1;
+	size_t *upcoming = bmalloc(count * sizeof(size_t));
+	upcoming[0] = st->pool_index;
+	memcpy(upcoming + 1, st->upcoming.array,
+	       st->upcoming.num * sizeof(size_t));
+	pthread_mutex_unlock(&st->pool_mutex);
+
+	bool *want = bzalloc(st->pool.num * sizeof(bool));
+	uint64_t used = 0;
+
+	// A single scene is only shown while it transitions, as before pools
+	if (st->pool.num < 2)
+		count = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		size_t index = upcoming[i];
+		if (index >= st->pool.num || want[index])
+			continue;
+
+		uint64_t bytes =
+			estimate_scene_memory(st->pool.array[index].scene);
+		if (used + bytes > st->pool_budget)
+			break;
+
+		want[index] = true;
+		used += bytes;
+	}
+
+	for (size_t i = 0; i < st->pool.num; i++) {
+		struct pool_entry *entry = &st->pool.array[i];
+		if (entry->warm == want[i])
+			continue;
+
+		entry->warm = want[i];
+		if (want[i])
+			obs_source_inc_showing(entry->scene);
+		else
+			obs_source_dec_showing(entry->scene);
+	}
+
+	bfree(want);
+	bfree(upcoming);
+}
+
+static void pool_advanced_task(void *param)
+{
+	obs_weak_source_t *weak = param;
+	obs_source_t *source = obs_weak_source_get_source(weak);
+	obs_weak_source_release(weak);
+	if (!source)
+		return;
+
+	struct scene_as_transition *st = obs_obj_get_data(source);
+	pool_update_warm_set(st);
+	scene_as_transition_refresh_auto_point(st, true);
+
+	obs_source_release(source);
+}
+
+// Moves on to the next pick once a transition has finished
+static void pool_advance(struct scene_as_transition *st)
+{
+	pthread_mutex_lock(&st->pool_mutex);
+	obs_source_t *retired = st->retired_scene;
+	st->retired_scene = NULL;
+
+	// A retired scene was played in place of the pick at pool_index
+	if (!retired && st->pool.num > 1 && st->upcoming.num) {
+		st->pool_index = st->upcoming.array[0];
+		da_erase(st->upcoming, 0);
+		pool_fill_upcoming(st);
+	}
+
+	obs_source_t *previous = st->transition_scene;
+	st->transition_scene = st->pool.num
+				       ? st->pool.array[st->pool_index].scene
+				       : NULL;
+	pthread_mutex_unlock(&st->pool_mutex);
+
+	obs_source_release(retired);
+	if (st->transition_scene == previous)
+		return;
+
+	// The filter is looked up again by name on the new scene
+	if (st->filter) {
+		obs_source_release(st->filter);
+		st->filter = NULL;
+	}
+
+	obs_queue_task(OBS_TASK_UI, pool_advanced_task,
+		       obs_source_get_weak_source(st->source), false);
+}
+
+static void pool_release(struct pool_entry *entries, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (entries[i].warm)
+			obs_source_dec_showing(entries[i].scene);
+		obs_source_release(entries[i].scene);
+	}
+	bfree(entries);
+}
+
+static void pool_add_scene(struct darray *pool, const char *name,
+			   float weight)
+{
+	obs_source_t *scene = obs_get_source_by_name(name);
+	if (!scene)
+		return;
+
+	struct pool_entry entry = {scene, weight > 0.0f ? weight : 1.0f,
+				   false};
+	darray_push_back(sizeof(struct pool_entry), pool, &entry);
+}
+
+// Entries are "Scene" or "Scene | weight"
+static void pool_add_list_item(struct darray *pool, const char *value)
+{
+	struct dstr name = {0};
+	float weight = 1.0f;
+
+	const char *sep = strrchr(value, '|');
+	double parsed = sep ? os_strtod(sep + 1) : 0.0;
+	if (parsed > 0.0) {
+		dstr_ncopy(&name, value, sep - value);
+		weight = (float)parsed;
+	} else {
+		dstr_copy(&name, value);
+	}
+	dstr_depad(&name);
+
+	if (!dstr_is_empty(&name))
+		pool_add_scene(pool, name.array, weight);
+	dstr_free(&name);
+}
+
+static void pool_build(struct scene_as_transition *st, obs_data_t *settings)
+{
+	// Sources are looked up before taking the lock so the render thread
+	// is never held up by it
+	DARRAY(struct pool_entry) pool;
+	da_init(pool);
+
+	pool_add_scene(&pool.da, obs_data_get_string(settings, "scene"), 1.0f);
+
+	obs_data_array_t *list = obs_data_get_array(settings, "scene_pool");
+	const size_t count = obs_data_array_count(list);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(list, i);
+		pool_add_list_item(&pool.da,
+				   obs_data_get_string(item, "value"));
+		obs_data_release(item);
+	}
+	obs_data_array_release(list);
+
+	pthread_mutex_lock(&st->pool_mutex);
+	struct pool_entry *old_entries = st->pool.array;
+	size_t old_count = st->pool.num;
+	obs_source_t *previous = st->transition_scene;
+
+	st->pool_mode = (enum pool_mode)obs_data_get_int(settings, "pool_mode");
+	st->pool_budget = (uint64_t)obs_data_get_int(settings, "pool_memory") *
+			  1024 * 1024;
+	st->pool.da = pool.da;
+	da_free(st->upcoming);
+
+	// The current pick stays if it is still in the pool
+	size_t current = st->pool.num;
+	for (size_t i = 0; i < st->pool.num; i++) {
+		if (st->pool.array[i].scene == previous) {
+			current = i;
+			break;
+		}
+	}
+
+	if (current < st->pool.num) {
+		st->pool_index = current;
+	} else {
+		st->pool_index = 0;
+		if (st->pool.num > 1 && st->pool_mode != POOL_MODE_ROUND_ROBIN)
+			st->pool_index = pool_pick(st, st->pool.num);
+
+		// A scene that is playing right now has to stay until its
+		// transition has finished, the new pick follows it
+		if (st->scene_active && previous) {
+			if (!st->retired_scene)
+				st->retired_scene = obs_source_get_ref(previous);
+		} else {
+			st->transition_scene =
+				st->pool.num
+					? st->pool.array[st->pool_index].scene
+					: NULL;
+		}
+	}
+	if (st->pool.num)
+		pool_fill_upcoming(st);
+	const bool changed = st->transition_scene != previous;
+	pthread_mutex_unlock(&st->pool_mutex);
+
+	// The filter is looked up again by name on the new scene
+	if (changed && st->filter) {
+		obs_source_release(st->filter);
+		st->filter = NULL;
+	}
+
+	// Scenes that stay in the pool keep being shown instead of reloading
+	for (size_t i = 0; i < st->pool.num; i++) {
+		for (size_t j = 0; j < old_count; j++) {
+			if (old_entries[j].warm &&
+			    old_entries[j].scene == st->pool.array[i].scene) {
+				old_entries[j].warm = false;
+				st->pool.array[i].warm = true;
+				break;
+			}
+		}
+	}
+
+	pool_release(old_entries, old_count);
+}
+
+static void scene_as_transition_select_routines(struct scene_as_transition *st,
+						bool cross_fade,
+						bool scene_audio);
+
 void scene_as_transition_update(void *data, obs_data_t *settings)
 {
 	struct scene_as_transition *st = data;
 	if (!st)
 		return;
 
-	obs_source_release(st->transition_scene);
-	st->transition_scene =
-		obs_get_source_by_name(obs_data_get_string(settings, "scene"));
+	pool_build(st, settings);
+	pool_update_warm_set(st);
 
 	st->duration = (float)obs_data_get_double(settings, "duration");
 	obs_transition_enable_fixed(st->source, true, (uint32_t)st->duration);
 
-	const bool time_based_transition_point =
-		obs_data_get_int(settings, "tp_type") == 1;
-	if (time_based_transition_point) {
-		const float transition_point_ms = (float)obs_data_get_double(
-			settings, "transition_point_ms");
-		if (st->duration > 0.0f)
-			st->transition_point =
-				transition_point_ms / st->duration;
-	} else {
-		st->transition_point = (float)obs_data_get_double(
-					       settings, "transition_point") /
-				       100.0f;
-	}
+	struct obs_video_info ovi;
+	if (obs_get_video_info(&ovi) && ovi.fps_num)
+		st->frame_interval_ns = 1000000000ULL * ovi.fps_den / ovi.fps_num;
+
+	st->tp_auto = obs_data_get_bool(settings, "tp_auto");
+
+	struct stinger_analysis detected;
+	enum detect_status detect_status = DETECT_NONE;
+	if (st->tp_auto || st->tp_detect_pending)
+		detect_status =
+			scene_as_transition_detect_point(st, true, &detected);
+	const bool has_detected = detect_status == DETECT_FOUND;
+	scene_as_transition_suggest_point(st, settings, detect_status,
+					  &detected);
+
+	float transition_point = settings_transition_point(st, settings);
+	if (st->tp_auto && has_detected && st->duration > 0.0f)
+		transition_point = detected_point(st, &detected);
+	scene_as_transition_set_point(st, transition_point);
+
+	obs_data_array_t *filter_events =
+		obs_data_get_array(settings, "filter_events");
+	filter_timeline_update(&st->timeline, filter_events, st->duration);
+	obs_data_array_release(filter_events);
 
 	const char *filter_name = obs_data_get_string(settings, "filter");
 
@@ -110,11 +744,11 @@ void scene_as_transition_update(void *data, obs_data_t *settings)
 
 		// Check if a valid filter is selected (not "NoFilterSelected" or empty)
 		const char *no_filter_text = obs_module_text("Filter.NoSelection");
-		bool has_valid_filter = filter_name && *filter_name &&
-					strcmp(filter_name, no_filter_text) != 0 &&
-					strcmp(filter_name, "filter") != 0;
+		st->filter_valid = filter_name && *filter_name &&
+				   strcmp(filter_name, no_filter_text) != 0 &&
+				   strcmp(filter_name, "filter") != 0;
 
-		if (has_valid_filter && st->transition_scene) {
+		if (st->filter_valid && st->transition_scene) {
 			st->filter = obs_source_get_filter_by_name(st->transition_scene,
 								   filter_name);
 			if (!st->filter) {
@@ -130,9 +764,6 @@ void scene_as_transition_update(void *data, obs_data_t *settings)
 		}
 	}
 
-	st->transition_a_mul = (1.0f / st->transition_point);
-	st->transition_b_mul = (1.0f / (1.0f - st->transition_point));
-
 	float def =
 		(float)obs_data_get_double(settings, "audio_volume") / 100.0f;
 	float db;
@@ -147,15 +778,12 @@ void scene_as_transition_update(void *data, obs_data_t *settings)
 				  -def) +
 		     LOG_OFFSET_DB;
 	const float mul = obs_db_to_mul(db);
-	obs_source_set_volume(st->transition_scene, mul);
+	for (size_t i = 0; i < st->pool.num; i++)
+		obs_source_set_volume(st->pool.array[i].scene, mul);
 
-	if (!obs_data_get_int(settings, "audio_fade_style")) {
-		st->mix_a = mix_a_fade_in_out;
-		st->mix_b = mix_b_fade_in_out;
-	} else {
-		st->mix_a = mix_a_cross_fade;
-		st->mix_b = mix_b_cross_fade;
-	}
+	scene_as_transition_select_routines(
+		st, obs_data_get_int(settings, "audio_fade_style") != 0,
+		def > 0.0f);
 
 	// Ensure transitioning is set to true initially
 	if (!st->transitioning) {
@@ -163,6 +791,59 @@ void scene_as_transition_update(void *data, obs_data_t *settings)
 	}
 }
 
+static void scene_as_transition_release_prearm(struct scene_as_transition *st)
+{
+	if (!st->prearmed_scene)
+		return;
+
+	obs_source_dec_showing(st->prearmed_scene);
+	obs_source_release(st->prearmed_scene);
+	st->prearmed_scene = NULL;
+}
+
+static void prearm_proc(void *data, calldata_t *cd)
+{
+	struct scene_as_transition *st = data;
+
+	long long timeout_ms = calldata_int(cd, "timeout_ms");
+	if (timeout_ms <= 0)
+		timeout_ms = PREARM_DEFAULT_TIMEOUT_MS;
+
+	st->prearm_timeout_ns = (uint64_t)timeout_ms * 1000000;
+	os_atomic_set_bool(&st->prearm_requested, true);
+	calldata_set_bool(cd, "success", st->transition_scene != NULL);
+}
+
+static void disarm_proc(void *data, calldata_t *cd)
+{
+	struct scene_as_transition *st = data;
+	UNUSED_PARAMETER(cd);
+	os_atomic_set_bool(&st->disarm_requested, true);
+}
+
+static void get_stats_proc(void *data, calldata_t *cd)
+{
+	struct scene_as_transition *st = data;
+	const struct transition_stats stats = st->stats;
+
+	calldata_set_int(cd, "transitions", (long long)stats.transitions);
+	calldata_set_int(cd, "last_activation_ns",
+			 (long long)stats.last_activation_ns);
+	calldata_set_int(cd, "last_render_ns",
+			 (long long)stats.last_render_ns);
+	calldata_set_int(cd, "max_render_ns", (long long)stats.max_render_ns);
+	calldata_set_int(cd, "avg_render_ns",
+			 stats.rendered_frames
+				 ? (long long)(stats.total_render_ns /
+					       stats.rendered_frames)
+				 : 0);
+	calldata_set_int(cd, "dropped_frames",
+			 (long long)stats.dropped_frames);
+	calldata_set_int(cd, "last_dropped_frames",
+			 (long long)stats.last_dropped_frames);
+	calldata_set_bool(cd, "prearmed", st->prearmed_scene != NULL);
+}
+
 static void *scene_as_transition_create(obs_data_t *settings,
 					obs_source_t *source)
 {
@@ -170,6 +851,8 @@ static void *scene_as_transition_create(obs_data_t *settings,
 
 	st = bzalloc(sizeof(*st));
 	st->source = source;
+	pthread_mutex_init(&st->pool_mutex, NULL);
+	filter_timeline_init(&st->timeline);
 
 	// Initialize transitioning to true
 	st->transitioning = true;
@@ -179,9 +862,17 @@ static void *scene_as_transition_create(obs_data_t *settings,
 
 	scene_as_transition_update(st, settings);
 
-	// Set initial audio mix callbacks
-	st->mix_a = mix_a_fade_in_out;
-	st->mix_b = mix_b_fade_in_out;
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	proc_handler_add(ph, "void prearm(in int timeout_ms, out bool success)",
+			 prearm_proc, st);
+	proc_handler_add(ph, "void disarm()", disarm_proc, st);
+	proc_handler_add(
+		ph,
+		"void get_stats(out int transitions, out int last_activation_ns, "
+		"out int last_render_ns, out int max_render_ns, "
+		"out int avg_render_ns, out int dropped_frames, "
+		"out int last_dropped_frames, out bool prearmed)",
+		get_stats_proc, st);
 
 	return st;
 }
@@ -189,7 +880,15 @@ static void *scene_as_transition_create(obs_data_t *settings,
 static void scene_as_transition_destroy(void *data)
 {
 	struct scene_as_transition *st = data;
-	obs_source_release(st->transition_scene);
+	scene_as_transition_release_prearm(st);
+	for (size_t i = 0; i < st->scrub_media.num; i++)
+		obs_source_release(st->scrub_media.array[i]);
+	da_free(st->scrub_media);
+	pool_release(st->pool.array, st->pool.num);
+	obs_source_release(st->retired_scene);
+	da_free(st->upcoming);
+	pthread_mutex_destroy(&st->pool_mutex);
+	filter_timeline_free(&st->timeline);
 	if (st->filter)
 		obs_source_release(st->filter);
 	if (st->filter_name)
@@ -197,17 +896,293 @@ static void scene_as_transition_destroy(void *data)
 	bfree(data);
 }
 
-static void scene_as_transition_video_render(void *data, gs_effect_t *effect)
+static void scene_as_transition_arm_timeline(struct scene_as_transition *st)
+{
+	obs_source_t *const targets[FILTER_TARGET_COUNT] = {
+		[FILTER_TARGET_SCENE] = st->transition_scene,
+		[FILTER_TARGET_A] = obs_transition_get_source(
+			st->source, OBS_TRANSITION_SOURCE_A),
+		[FILTER_TARGET_B] = obs_transition_get_source(
+			st->source, OBS_TRANSITION_SOURCE_B),
+	};
+
+	filter_timeline_arm(&st->timeline, targets);
+
+	obs_source_release(targets[FILTER_TARGET_A]);
+	obs_source_release(targets[FILTER_TARGET_B]);
+}
+
+static void scene_as_transition_transition_start(void *data)
 {
 	struct scene_as_transition *st = data;
 
-	// NULL safety check
-	if (!st || !st->transition_scene) {
+	// Sources A and B change with every transition, so the timeline is
+	// armed again from the render thread
+	os_atomic_set_bool(&st->timeline_restart, true);
+}
+
+// Lazy load filter if it wasn't available during init
+static void scene_as_transition_load_filter(struct scene_as_transition *st)
+{
+	if (st->filter || !st->filter_name || !st->transition_scene)
+		return;
+
+	if (!st->filter_valid)
+		return;
+
+	st->filter = obs_source_get_filter_by_name(st->transition_scene,
+						   st->filter_name);
+	if (st->filter) {
+		blog(LOG_INFO,
+		     "[StreamUP Scene as Transition] Lazy loading succeeded: "
+		     "Found filter '%s' on scene '%s'",
+		     st->filter_name, obs_source_get_name(st->transition_scene));
+	} else {
+		blog(LOG_WARNING,
+		     "[StreamUP Scene as Transition] Lazy loading failed: "
+		     "Filter '%s' still not found on scene '%s'",
+		     st->filter_name, obs_source_get_name(st->transition_scene));
+	}
+}
+
+// Walks the scene for stinger media, so it stays off the graphics thread
+static void prearm_analysis_task(void *param)
+{
+	obs_weak_source_t *weak = param;
+	obs_source_t *source = obs_weak_source_get_source(weak);
+	obs_weak_source_release(weak);
+	if (!source)
+		return;
+
+	struct scene_as_transition *st = obs_obj_get_data(source);
+	struct stinger_analysis detected;
+	scene_as_transition_detect_point(st, true, &detected);
+
+	obs_source_release(source);
+}
+
+// Loads everything the next transition needs ahead of time: the scene is
+// shown so its sources load, the filter is resolved and missing stinger
+// analyses are queued
+static void scene_as_transition_prearm(struct scene_as_transition *st)
+{
+	pthread_mutex_lock(&st->pool_mutex);
+	obs_source_t *scene = obs_source_get_ref(st->transition_scene);
+	pthread_mutex_unlock(&st->pool_mutex);
+	if (!scene)
 		return;
+
+	const uint64_t start = os_gettime_ns();
+
+	if (st->prearmed_scene != scene) {
+		scene_as_transition_release_prearm(st);
+		st->prearmed_scene = obs_source_get_ref(scene);
+		obs_source_inc_showing(st->prearmed_scene);
+	}
+	st->prearm_deadline = start + st->prearm_timeout_ns;
+
+	scene_as_transition_load_filter(st);
+
+	obs_queue_task(OBS_TASK_UI, prearm_analysis_task,
+		       obs_source_get_weak_source(st->source), false);
+
+	blog(LOG_INFO,
+	     "[StreamUP Scene as Transition] Pre-armed '%s' with scene '%s' in %.2f ms",
+	     obs_source_get_name(st->source), obs_source_get_name(scene),
+	     (double)(os_gettime_ns() - start) / 1000000.0);
+
+	obs_source_release(scene);
+}
+
+static void stats_add_frame(struct transition_stats *stats, uint64_t start,
+			    uint64_t render_ns, uint64_t interval_ns)
+{
+	stats->last_render_ns = render_ns;
+	if (render_ns > stats->max_render_ns)
+		stats->max_render_ns = render_ns;
+	stats->total_render_ns += render_ns;
+	stats->rendered_frames++;
+
+	// Frames where the transition was not rendered at all
+	if (stats->last_frame_ts && interval_ns) {
+		uint64_t elapsed = start - stats->last_frame_ts;
+		uint64_t frames = (elapsed + interval_ns / 2) / interval_ns;
+		if (frames > 1) {
+			stats->dropped_frames += frames - 1;
+			stats->last_dropped_frames += frames - 1;
+		}
 	}
+	stats->last_frame_ts = start;
+}
 
-	float t = obs_transition_get_time(st->source);
-	bool use_a = t < st->transition_point;
+static void collect_scrub_media(obs_source_t *source, void *param)
+{
+	struct scene_as_transition *st = param;
+
+	if (obs_source_get_output_flags(source) &
+	    OBS_SOURCE_CONTROLLABLE_MEDIA) {
+		obs_source_t *media = obs_source_get_ref(source);
+		if (media)
+			da_push_back(st->scrub_media, &media);
+	}
+}
+
+// Media in the scene is paused for the drag and follows t instead of
+// restarting every time the scene is activated again
+static void scrub_begin(struct scene_as_transition *st)
+{
+	enum_scene_sources(st->transition_scene, collect_scrub_media, st);
+
+	st->scrub_seek_ms = -1;
+	st->scrub_use_a = true;
+}
+
+static void scrub_end(struct scene_as_transition *st, float t)
+{
+	const bool resume = t > 0.0f && t < 1.0f;
+
+	for (size_t i = 0; i < st->scrub_media.num; i++) {
+		if (resume)
+			obs_source_media_play_pause(st->scrub_media.array[i],
+						    false);
+		obs_source_release(st->scrub_media.array[i]);
+	}
+	da_free(st->scrub_media);
+}
+
+static void scrub_seek(struct scene_as_transition *st, float t)
+{
+	const int64_t ms = (int64_t)(t * st->duration);
+	const int64_t frame_ms = (int64_t)(st->frame_interval_ns / 1000000);
+
+	// Only seek once t has moved by at least a frame
+	int64_t diff = ms - st->scrub_seek_ms;
+	if (st->scrub_seek_ms >= 0 && diff < frame_ms && diff > -frame_ms)
+		return;
+
+	st->scrub_seek_ms = ms;
+	for (size_t i = 0; i < st->scrub_media.num; i++) {
+		obs_source_t *media = st->scrub_media.array[i];
+
+		// Activating the scene restarts media, so pause it again here
+		if (obs_source_media_get_state(media) ==
+		    OBS_MEDIA_STATE_PLAYING)
+			obs_source_media_play_pause(media, true);
+		obs_source_media_set_time(media, ms);
+	}
+}
+
+static void scrub_update(struct scene_as_transition *st, float t)
+{
+	const bool scrubbing = os_gettime_ns() - st->tbar_event_ns <
+			       SCRUB_HOLD_NS;
+
+	if (scrubbing && !st->scrubbing)
+		scrub_begin(st);
+	else if (!scrubbing && st->scrubbing)
+		scrub_end(st, t);
+
+	st->scrubbing = scrubbing;
+	if (scrubbing)
+		scrub_seek(st, t);
+}
+
+// Ends the transition: the scene is deactivated, the filter disabled and
+// the timeline finished, or undone when a drag was pulled back to the start
+static void scene_as_transition_deactivate(struct scene_as_transition *st,
+					   float t)
+{
+	const bool was_active = st->scene_active;
+	if (was_active) {
+		if (obs_source_active(st->source))
+			obs_source_dec_active(st->transition_scene);
+		if (obs_source_showing(st->source))
+			obs_source_dec_showing(st->transition_scene);
+	}
+
+	// Disable filter when transition ends
+	if (st->filter)
+		obs_source_set_enabled(st->filter, false);
+
+	if (st->timeline.armed) {
+		if (t <= 0.0f)
+			filter_timeline_cancel(&st->timeline);
+		else
+			filter_timeline_finish(&st->timeline);
+	}
+
+	pthread_mutex_lock(&st->pool_mutex);
+	st->scene_active = false;
+	st->transitioning = false;
+	pthread_mutex_unlock(&st->pool_mutex);
+
+	if (was_active) {
+		scene_as_transition_release_prearm(st);
+		pool_advance(st);
+	}
+}
+
+static void scene_as_transition_video_tick(void *data, float seconds)
+{
+	struct scene_as_transition *st = data;
+	UNUSED_PARAMETER(seconds);
+
+	if (os_atomic_load_bool(&st->disarm_requested)) {
+		os_atomic_set_bool(&st->disarm_requested, false);
+		scene_as_transition_release_prearm(st);
+	}
+
+	if (os_atomic_load_bool(&st->prearm_requested)) {
+		os_atomic_set_bool(&st->prearm_requested, false);
+		scene_as_transition_prearm(st);
+	}
+
+	// st->transitioning is also set outside of transitions, so the time
+	// tells whether one is running
+	const float t = obs_transition_get_time(st->source);
+	const bool in_transition = t > 0.0f && t < 1.0f;
+
+	scrub_update(st, t);
+
+	// video_render is not called once the transition has stopped, so the
+	// scene is deactivated from here
+	if ((st->scene_active || st->transitioning) && !in_transition &&
+	    !st->scrubbing)
+		scene_as_transition_deactivate(st, t);
+
+	if (st->prearmed_scene && !in_transition &&
+	    os_gettime_ns() > st->prearm_deadline) {
+		blog(LOG_INFO,
+		     "[StreamUP Scene as Transition] Pre-arm of '%s' timed out",
+		     obs_source_get_name(st->source));
+		scene_as_transition_release_prearm(st);
+	}
+}
+
+// The render and audio paths are written once as templates and expanded
+// for every combination of the settings they depend on, so the per-frame
+// and per-tick code has no configuration branches left in it
+
+typedef void (*render_routine_t)(struct scene_as_transition *st, float t);
+typedef bool (*audio_routine_t)(struct scene_as_transition *st,
+				uint64_t *ts_out,
+				struct obs_source_audio_mix *audio,
+				uint32_t mixers, size_t channels,
+				size_t sample_rate);
+
+static force_inline void render_template(struct scene_as_transition *st,
+					 float t, const bool has_filter,
+					 const bool has_timeline)
+{
+	bool use_a;
+	if (st->scrubbing) {
+		use_a = t < st->transition_point + (st->scrub_use_a
+							    ? SCRUB_HYSTERESIS
+							    : -SCRUB_HYSTERESIS);
+		st->scrub_use_a = use_a;
+	} else {
+		use_a = t < st->transition_point;
+	}
 
 	enum obs_transition_target target = use_a ? OBS_TRANSITION_SOURCE_A
 						  : OBS_TRANSITION_SOURCE_B;
@@ -215,71 +1190,83 @@ static void scene_as_transition_video_render(void *data, gs_effect_t *effect)
 	if (!obs_transition_video_render_direct(st->source, target))
 		return;
 
+	if (os_atomic_load_bool(&st->timeline_restart)) {
+		os_atomic_set_bool(&st->timeline_restart, false);
+		if (has_timeline)
+			filter_timeline_finish(&st->timeline);
+
+		st->stats.transitions++;
+		st->stats.last_dropped_frames = 0;
+	}
+
 	if (t > 0.0f && t < 1.0f) {
+		if (has_timeline) {
+			if (!st->timeline.armed)
+				scene_as_transition_arm_timeline(st);
+			filter_timeline_advance(&st->timeline, t);
+			if (st->scrubbing)
+				filter_timeline_rewind(&st->timeline, t);
+		}
+
 		obs_source_video_render(st->transition_scene);
+	} else if (has_timeline && st->timeline.armed && st->scrubbing &&
+		   t <= 0.0f) {
+		// A drag that is pulled back to the start undoes the events,
+		// video_tick cancels the rest once the drag has ended
+		filter_timeline_rewind(&st->timeline, t);
 	}
 
-	if (use_a) {
-		if (!st->transitioning) {
+	// Once it has stopped, the transition is only started again by t
+	// moving off the start
+	if (use_a && (st->scene_active || t > 0.0f)) {
+		if (!st->scene_active) {
+			const uint64_t activation_start = os_gettime_ns();
+
+			// pool_build does not swap the scene from here on
+			pthread_mutex_lock(&st->pool_mutex);
+			st->scene_active = true;
 			st->transitioning = true;
+			pthread_mutex_unlock(&st->pool_mutex);
+
 			if (obs_source_showing(st->source))
 				obs_source_inc_showing(st->transition_scene);
 			if (obs_source_active(st->source))
 				obs_source_inc_active(st->transition_scene);
 
-			// Lazy load filter if it wasn't available during init
-			if (!st->filter && st->filter_name && st->transition_scene) {
-				const char *no_filter_text = obs_module_text("Filter.NoSelection");
-				bool has_valid_filter = st->filter_name && *st->filter_name &&
-							strcmp(st->filter_name, no_filter_text) != 0 &&
-							strcmp(st->filter_name, "filter") != 0;
-
-				if (has_valid_filter) {
-					st->filter = obs_source_get_filter_by_name(
-						st->transition_scene, st->filter_name);
-					if (st->filter) {
-						blog(LOG_INFO,
-						     "[StreamUP Scene as Transition] Lazy loading succeeded: "
-						     "Found filter '%s' on scene '%s'",
-						     st->filter_name,
-						     obs_source_get_name(st->transition_scene));
-					} else {
-						blog(LOG_WARNING,
-						     "[StreamUP Scene as Transition] Lazy loading failed: "
-						     "Filter '%s' still not found on scene '%s'",
-						     st->filter_name,
-						     obs_source_get_name(st->transition_scene));
-					}
-				}
+			// Activation restarts media, a scrub seeks it back
+			st->scrub_seek_ms = -1;
+
+			if (has_filter) {
+				scene_as_transition_load_filter(st);
+
+				if (st->filter)
+					obs_source_set_enabled(st->filter,
+							       true);
 			}
 
-			if (st->filter)
-				obs_source_set_enabled(st->filter, true);
+			st->stats.last_activation_ns =
+				os_gettime_ns() - activation_start;
 		}
 		obs_source_video_render(st->transition_scene);
-	} else if ((t <= 0.0f || t >= 1.0f) && st->transitioning) {
-		st->transitioning = false;
-		if (obs_source_active(st->source))
-			obs_source_dec_active(st->transition_scene);
-		if (obs_source_showing(st->source))
-			obs_source_dec_showing(st->transition_scene);
-
-		// Disable filter when transition ends
-		if (st->filter)
-			obs_source_set_enabled(st->filter, false);
 	}
-
-	UNUSED_PARAMETER(effect);
 }
 
-static bool scene_as_transition_audio_render(void *data, uint64_t *ts_out,
-					     struct obs_source_audio_mix *audio,
-					     uint32_t mixers, size_t channels,
-					     size_t sample_rate)
+static force_inline bool
+audio_render_template(struct scene_as_transition *st, uint64_t *ts_out,
+		      struct obs_source_audio_mix *audio, uint32_t mixers,
+		      size_t channels, size_t sample_rate,
+		      const bool cross_fade, const bool scene_audio)
 {
-	struct scene_as_transition *st = data;
-	if (!st || !st->transition_scene)
-		return false;
+	obs_transition_audio_mix_callback_t mix_a =
+		cross_fade ? mix_a_cross_fade : mix_a_fade_in_out;
+	obs_transition_audio_mix_callback_t mix_b =
+		cross_fade ? mix_b_cross_fade : mix_b_fade_in_out;
+
+	// Scene audio at zero volume is not mixed in at all
+	if (!scene_audio)
+		return obs_transition_audio_render(st->source, ts_out, audio,
+						   mixers, channels,
+						   sample_rate, mix_a, mix_b);
 
 	uint64_t ts = 0;
 	if (!obs_source_audio_pending(st->transition_scene)) {
@@ -291,8 +1278,8 @@ static bool scene_as_transition_audio_render(void *data, uint64_t *ts_out,
 	const bool success = obs_transition_audio_render(st->source, ts_out,
 							 audio, mixers,
 							 channels, sample_rate,
-							 st->mix_a, st->mix_b);
-	if (!ts || !st->transitioning)
+							 mix_a, mix_b);
+	if (!ts || !st->scene_active)
 		return success;
 
 	if (!*ts_out || ts < *ts_out)
@@ -317,6 +1304,89 @@ static bool scene_as_transition_audio_render(void *data, uint64_t *ts_out,
 	return true;
 }
 
+#define DEFINE_RENDER_ROUTINE(name, has_filter, has_timeline)             \
+	static void name(struct scene_as_transition *st, float t)          \
+	{                                                                  \
+		render_template(st, t, has_filter, has_timeline);          \
+	}
+
+#define DEFINE_AUDIO_ROUTINE(name, cross_fade, scene_audio)                 \
+	static bool name(struct scene_as_transition *st, uint64_t *ts_out,  \
+			 struct obs_source_audio_mix *audio, uint32_t mixers, \
+			 size_t channels, size_t sample_rate)                 \
+	{                                                                   \
+		return audio_render_template(st, ts_out, audio, mixers,     \
+					     channels, sample_rate,         \
+					     cross_fade, scene_audio);      \
+	}
+
+DEFINE_RENDER_ROUTINE(render_plain, false, false)
+DEFINE_RENDER_ROUTINE(render_timeline, false, true)
+DEFINE_RENDER_ROUTINE(render_filter, true, false)
+DEFINE_RENDER_ROUTINE(render_filter_timeline, true, true)
+
+DEFINE_AUDIO_ROUTINE(audio_fade_in_out, false, false)
+DEFINE_AUDIO_ROUTINE(audio_fade_in_out_scene, false, true)
+DEFINE_AUDIO_ROUTINE(audio_cross_fade, true, false)
+DEFINE_AUDIO_ROUTINE(audio_cross_fade_scene, true, true)
+
+// Indexed by [has_filter][has_timeline]
+static const render_routine_t render_routines[2][2] = {
+	{render_plain, render_timeline},
+	{render_filter, render_filter_timeline},
+};
+
+// Indexed by [cross_fade][scene_audio]
+static const audio_routine_t audio_routines[2][2] = {
+	{audio_fade_in_out, audio_fade_in_out_scene},
+	{audio_cross_fade, audio_cross_fade_scene},
+};
+
+static void scene_as_transition_select_routines(struct scene_as_transition *st,
+						bool cross_fade,
+						bool scene_audio)
+{
+	const bool has_timeline = st->timeline.events.num > 0;
+	st->render = render_routines[st->filter_valid][has_timeline];
+	st->audio_render = audio_routines[cross_fade][scene_audio];
+}
+
+static void scene_as_transition_video_render(void *data, gs_effect_t *effect)
+{
+	struct scene_as_transition *st = data;
+
+	// NULL safety check
+	if (!st || !st->transition_scene) {
+		return;
+	}
+
+	const uint64_t start = os_gettime_ns();
+	const float t = obs_transition_get_time(st->source);
+
+	st->render(st, t);
+
+	if (t > 0.0f && t < 1.0f)
+		stats_add_frame(&st->stats, start, os_gettime_ns() - start,
+				st->frame_interval_ns);
+	else
+		st->stats.last_frame_ts = 0;
+
+	UNUSED_PARAMETER(effect);
+}
+
+static bool scene_as_transition_audio_render(void *data, uint64_t *ts_out,
+					     struct obs_source_audio_mix *audio,
+					     uint32_t mixers, size_t channels,
+					     size_t sample_rate)
+{
+	struct scene_as_transition *st = data;
+	if (!st || !st->transition_scene)
+		return false;
+
+	return st->audio_render(st, ts_out, audio, mixers, channels,
+				sample_rate);
+}
+
 static enum gs_color_space scene_as_transition_video_get_color_space(
 	void *data, size_t count, const enum gs_color_space *preferred_spaces)
 {
@@ -336,6 +1406,7 @@ void scene_as_transition_defaults(obs_data_t *settings)
 				    obs_module_text("Filter.NoSelection"));
 	obs_data_set_default_string(settings, "prev_scene", "");
 	obs_data_set_default_double(settings, "audio_volume", 100.0);
+	obs_data_set_default_int(settings, "pool_memory", 512);
 }
 
 static bool transition_point_type_modified(obs_properties_t *ppts,
@@ -360,6 +1431,22 @@ static bool transition_point_type_modified(obs_properties_t *ppts,
 	return true;
 }
 
+static bool detect_transition_point_clicked(obs_properties_t *props,
+					    obs_property_t *property,
+					    void *data)
+{
+	struct scene_as_transition *st = data;
+
+	// The result is filled in straight away if it is cached, otherwise
+	// once the background analysis has finished
+	st->tp_detect_pending = true;
+	scene_as_transition_apply_suggestion(st, true);
+
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
+	return true;
+}
+
 bool scene_as_transition_list_add_scene(void *data,
 					obs_source_t *transition_scene)
 {
@@ -411,7 +1498,7 @@ static void scene_as_transition_enum_active_sources(
 	void *data, obs_source_enum_proc_t enum_callback, void *param)
 {
 	struct scene_as_transition *st = data;
-	if (st->transition_scene && st->transitioning)
+	if (st->transition_scene && st->scene_active)
 		enum_callback(st->source, st->transition_scene, param);
 }
 
@@ -419,8 +1506,11 @@ static void scene_as_transition_enum_all_sources(
 	void *data, obs_source_enum_proc_t enum_callback, void *param)
 {
 	struct scene_as_transition *st = data;
-	if (st->transition_scene)
-		enum_callback(st->source, st->transition_scene, param);
+
+	pthread_mutex_lock(&st->pool_mutex);
+	for (size_t i = 0; i < st->pool.num; i++)
+		enum_callback(st->source, st->pool.array[i].scene, param);
+	pthread_mutex_unlock(&st->pool_mutex);
 }
 
 obs_properties_t *scene_as_transition_properties(void *data)
@@ -438,7 +1528,38 @@ obs_properties_t *scene_as_transition_properties(void *data)
 	obs_enum_scenes(scene_as_transition_list_add_scene, scene);
 	obs_property_set_modified_callback(scene, scene_modified);
 
-	obs_property_t *p = obs_properties_add_float(
+	obs_properties_t *pool_group = obs_properties_create();
+
+	obs_properties_add_group(props, "pool_group",
+				 obs_module_text("Pool.Settings"),
+				 OBS_GROUP_NORMAL, pool_group);
+
+	obs_property_t *p = obs_properties_add_editable_list(
+		pool_group, "scene_pool", obs_module_text("Pool.Scenes"),
+		OBS_EDITABLE_LIST_TYPE_STRINGS, NULL, NULL);
+	obs_property_set_long_description(
+		p, obs_module_text("Pool.Scenes.Description"));
+
+	p = obs_properties_add_list(pool_group, "pool_mode",
+				    obs_module_text("Pool.Mode"),
+				    OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, obs_module_text("Pool.Mode.RoundRobin"),
+				  POOL_MODE_ROUND_ROBIN);
+	obs_property_list_add_int(p, obs_module_text("Pool.Mode.Random"),
+				  POOL_MODE_RANDOM);
+	obs_property_list_add_int(p, obs_module_text("Pool.Mode.Weighted"),
+				  POOL_MODE_WEIGHTED);
+	obs_property_set_long_description(
+		p, obs_module_text("Pool.Mode.Description"));
+
+	p = obs_properties_add_int(pool_group, "pool_memory",
+				   obs_module_text("Pool.Memory"), 0, 16384,
+				   64);
+	obs_property_int_set_suffix(p, " MB");
+	obs_property_set_long_description(
+		p, obs_module_text("Pool.Memory.Description"));
+
+	p = obs_properties_add_float(
 		props, "duration", obs_module_text("Transition.Duration"), 0.0, 30000.0,
 		100.0);
 	obs_property_float_set_suffix(p, " ms");
@@ -476,6 +1597,40 @@ obs_properties_t *scene_as_transition_properties(void *data)
 	obs_property_set_long_description(
 		p, obs_module_text("TransitionPoint.Time.Description"));
 
+	p = obs_properties_add_bool(transition_point_group, "tp_auto",
+				    obs_module_text("TransitionPoint.Auto"));
+	obs_property_set_long_description(
+		p, obs_module_text("TransitionPoint.Auto.Description"));
+	obs_property_set_enabled(p, stinger_analysis_available());
+
+	p = obs_properties_add_button(transition_point_group, "tp_detect",
+				      obs_module_text("TransitionPoint.Detect"),
+				      detect_transition_point_clicked);
+	obs_property_set_long_description(
+		p, obs_module_text("TransitionPoint.Detect.Description"));
+	obs_property_set_enabled(p, stinger_analysis_available());
+
+	struct stinger_analysis detected;
+	struct dstr detected_text = {0};
+	switch (st ? scene_as_transition_detect_point(st, false, &detected)
+		   : DETECT_NONE) {
+	case DETECT_FOUND:
+		dstr_printf(&detected_text,
+			    obs_module_text("TransitionPoint.Detected"),
+			    detected.peak_ms, detected.peak_coverage * 100.0f);
+		break;
+	case DETECT_PENDING:
+		dstr_copy(&detected_text,
+			  obs_module_text("TransitionPoint.Detected.Pending"));
+		break;
+	default:
+		dstr_copy(&detected_text,
+			  obs_module_text("TransitionPoint.Detected.None"));
+	}
+	obs_properties_add_text(transition_point_group, "tp_detected",
+				detected_text.array, OBS_TEXT_INFO);
+	dstr_free(&detected_text);
+
 	obs_properties_t *audio_group = obs_properties_create();
 
 	obs_properties_add_group(props, "audio_group",
@@ -509,6 +1664,12 @@ obs_properties_t *scene_as_transition_properties(void *data)
 	obs_source_enum_filters(st->transition_scene,
 				scene_as_transition_list_add_filter, filter);
 
+	p = obs_properties_add_editable_list(
+		props, "filter_events", obs_module_text("Filter.Events"),
+		OBS_EDITABLE_LIST_TYPE_STRINGS, NULL, NULL);
+	obs_property_set_long_description(
+		p, obs_module_text("Filter.Events.Description"));
+
 	obs_properties_add_text(
 		props, "plugin_info",
 		"<a href=\"https://github.com/andilippi/obs-scene-as-transition\">Scene As Transition</a> (" PROJECT_VERSION
@@ -531,8 +1692,10 @@ struct obs_source_info scene_as_transition = {
 	.get_defaults = scene_as_transition_defaults,
 	.enum_active_sources = scene_as_transition_enum_active_sources,
 	.enum_all_sources = scene_as_transition_enum_all_sources,
+	.video_tick = scene_as_transition_video_tick,
 	.video_render = scene_as_transition_video_render,
 	.audio_render = scene_as_transition_audio_render,
+	.transition_start = scene_as_transition_transition_start,
 	.video_get_color_space = scene_as_transition_video_get_color_space,
 	.get_properties = scene_as_transition_properties,
 };
@@ -760,6 +1923,24 @@ static void check_for_old_plugin(void)
 	dstr_free(&old_plugin_path);
 }
 
+static void frontend_event(enum obs_frontend_event event, void *private_data)
+{
+	UNUSED_PARAMETER(private_data);
+	if (event != OBS_FRONTEND_EVENT_TBAR_VALUE_CHANGED)
+		return;
+
+	// The T-bar drives the transition on the main output
+	obs_source_t *transition = obs_get_output_source(0);
+	if (transition &&
+	    strcmp(obs_source_get_unversioned_id(transition),
+		   "scene_as_transition") == 0) {
+		struct scene_as_transition *st = obs_obj_get_data(transition);
+		if (st)
+			st->tbar_event_ns = os_gettime_ns();
+	}
+	obs_source_release(transition);
+}
+
 bool obs_module_load(void)
 {
 	blog(LOG_INFO, "[StreamUP Scene as Transition] loaded version %s",
@@ -768,6 +1949,20 @@ bool obs_module_load(void)
 	// Check for old plugin version
 	check_for_old_plugin();
 
+	stinger_analysis_init();
+
 	obs_register_source(&scene_as_transition);
+	obs_frontend_add_event_callback(frontend_event, NULL);
 	return true;
 }
+
+void obs_module_post_load(void)
+{
+	websocket_vendor_register();
+}
+
+void obs_module_unload(void)
+{
+	obs_frontend_remove_event_callback(frontend_event, NULL);
+	stinger_analysis_free();
+}
@@ -0,0 +1,483 @@
+#include "stinger-analysis.h"
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/darray.h>
+
+#ifdef ENABLE_STINGER_ANALYSIS
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+#endif
+
+#define INDEX_FILE "stinger-index.json"
+
+// Frames are scaled down to this width before measuring alpha
+#define ANALYSIS_WIDTH 64
+// Frames within this much of the best coverage count as the same plateau
+#define COVERAGE_TOLERANCE 0.005f
+
+struct index_entry {
+	char *path;
+	int64_t mtime;
+	int64_t size;
+	struct stinger_analysis result;
+};
+
+struct analysis_waiter {
+	stinger_analysis_done_t done;
+	void *param;
+};
+
+// Everyone who queued the same file waits on the one job
+struct analysis_job {
+	char *path;
+	DARRAY(struct analysis_waiter) waiters;
+};
+
+struct coverage_sample {
+	double ms;
+	float coverage;
+};
+
+static pthread_mutex_t index_mutex;
+static pthread_t analysis_thread;
+static os_sem_t *analysis_sem = NULL;
+static bool analysis_thread_created = false;
+static volatile bool analysis_stopping = false;
+
+static DARRAY(struct index_entry) index_entries;
+static DARRAY(struct analysis_job) pending_jobs;
+// Job being decoded, more waiters can still join it
+static struct analysis_job running_job;
+
+static bool get_file_key(const char *path, int64_t *mtime, int64_t *size)
+{
+	struct stat st;
+	if (!path || !*path || os_stat(path, &st) != 0)
+		return false;
+
+	*mtime = (int64_t)st.st_mtime;
+	*size = (int64_t)st.st_size;
+	return true;
+}
+
+static struct index_entry *find_entry(const char *path)
+{
+	for (size_t i = 0; i < index_entries.num; i++) {
+		if (strcmp(index_entries.array[i].path, path) == 0)
+			return &index_entries.array[i];
+	}
+	return NULL;
+}
+
+static void load_index(void)
+{
+	char *file = obs_module_config_path(INDEX_FILE);
+	obs_data_t *data = obs_data_create_from_json_file_safe(file, "bak");
+	bfree(file);
+	if (!data)
+		return;
+
+	obs_data_array_t *files = obs_data_get_array(data, "files");
+	size_t count = obs_data_array_count(files);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(files, i);
+		const char *path = obs_data_get_string(item, "path");
+
+		if (*path && !find_entry(path)) {
+			struct index_entry entry = {0};
+			entry.path = bstrdup(path);
+			entry.mtime = obs_data_get_int(item, "mtime");
+			entry.size = obs_data_get_int(item, "size");
+			entry.result.has_alpha = obs_data_get_bool(item, "has_alpha");
+			entry.result.duration_ms = obs_data_get_double(item, "duration_ms");
+			entry.result.peak_ms = obs_data_get_double(item, "peak_ms");
+			entry.result.peak_coverage = (float)obs_data_get_double(item, "peak_coverage");
+			da_push_back(index_entries, &entry);
+		}
+
+		obs_data_release(item);
+	}
+
+	obs_data_array_release(files);
+	obs_data_release(data);
+
+	blog(LOG_INFO, "[StreamUP Scene as Transition] Loaded %zu cached stinger analyses", index_entries.num);
+}
+
+// Must be called with index_mutex held
+static void save_index(void)
+{
+	obs_data_t *data = obs_data_create();
+	obs_data_array_t *files = obs_data_array_create();
+
+	for (size_t i = 0; i < index_entries.num; i++) {
+		const struct index_entry *entry = &index_entries.array[i];
+		obs_data_t *item = obs_data_create();
+		obs_data_set_string(item, "path", entry->path);
+		obs_data_set_int(item, "mtime", entry->mtime);
+		obs_data_set_int(item, "size", entry->size);
+		obs_data_set_bool(item, "has_alpha", entry->result.has_alpha);
+		obs_data_set_double(item, "duration_ms", entry->result.duration_ms);
+		obs_data_set_double(item, "peak_ms", entry->result.peak_ms);
+		obs_data_set_double(item, "peak_coverage", entry->result.peak_coverage);
+		obs_data_array_push_back(files, item);
+		obs_data_release(item);
+	}
+
+	obs_data_set_array(data, "files", files);
+
+	char *dir = obs_module_config_path("");
+	os_mkdirs(dir);
+	bfree(dir);
+
+	char *file = obs_module_config_path(INDEX_FILE);
+	if (!obs_data_save_json_safe(data, file, "tmp", "bak"))
+		blog(LOG_WARNING, "[StreamUP Scene as Transition] Failed to save stinger index to '%s'", file);
+	bfree(file);
+
+	obs_data_array_release(files);
+	obs_data_release(data);
+}
+
+#ifdef ENABLE_STINGER_ANALYSIS
+static const AVCodec *find_alpha_decoder(AVStream *stream)
+{
+	// The native VP8/VP9 decoders drop the alpha channel, same as in the
+	// media source, so use libvpx when the stream says it carries alpha
+	AVDictionaryEntry *alpha = av_dict_get(stream->metadata, "alpha_mode", NULL, 0);
+	if (alpha && strcmp(alpha->value, "1") == 0) {
+		if (stream->codecpar->codec_id == AV_CODEC_ID_VP8)
+			return avcodec_find_decoder_by_name("libvpx");
+		if (stream->codecpar->codec_id == AV_CODEC_ID_VP9)
+			return avcodec_find_decoder_by_name("libvpx-vp9");
+	}
+	return NULL;
+}
+
+static bool measure_frame(AVFrame *frame, struct SwsContext **sws, uint8_t *rgba, int height, float *coverage)
+{
+	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+	if (!desc || (desc->flags & AV_PIX_FMT_FLAG_ALPHA) == 0)
+		return false;
+
+	*sws = sws_getCachedContext(*sws, frame->width, frame->height, frame->format, ANALYSIS_WIDTH, height,
+				    AV_PIX_FMT_RGBA, SWS_POINT, NULL, NULL, NULL);
+	if (!*sws)
+		return false;
+
+	uint8_t *dst[4] = {rgba, NULL, NULL, NULL};
+	int dst_linesize[4] = {ANALYSIS_WIDTH * 4, 0, 0, 0};
+	sws_scale(*sws, (const uint8_t *const *)frame->data, frame->linesize, 0, frame->height, dst, dst_linesize);
+
+	uint64_t total = 0;
+	const size_t pixels = (size_t)ANALYSIS_WIDTH * (size_t)height;
+	for (size_t i = 0; i < pixels; i++)
+		total += rgba[i * 4 + 3];
+
+	*coverage = (float)((double)total / (255.0 * (double)pixels));
+	return true;
+}
+
+static bool analyse_file(const char *path, struct stinger_analysis *result)
+{
+	AVFormatContext *format = NULL;
+	AVCodecContext *decoder = NULL;
+	AVPacket *packet = NULL;
+	AVFrame *frame = NULL;
+	struct SwsContext *sws = NULL;
+	uint8_t *rgba = NULL;
+	DARRAY(struct coverage_sample) samples;
+	bool success = false;
+
+	da_init(samples);
+	memset(result, 0, sizeof(*result));
+
+	if (avformat_open_input(&format, path, NULL, NULL) < 0)
+		goto done;
+	if (avformat_find_stream_info(format, NULL) < 0)
+		goto done;
+
+	const AVCodec *codec = NULL;
+	int index = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+	if (index < 0)
+		goto done;
+
+	AVStream *stream = format->streams[index];
+	const AVCodec *alpha_codec = find_alpha_decoder(stream);
+	if (alpha_codec)
+		codec = alpha_codec;
+
+	decoder = avcodec_alloc_context3(codec);
+	if (!decoder || avcodec_parameters_to_context(decoder, stream->codecpar) < 0 ||
+	    avcodec_open2(decoder, codec, NULL) < 0)
+		goto done;
+
+	if (decoder->width <= 0 || decoder->height <= 0)
+		goto done;
+
+	int height = (int)((int64_t)ANALYSIS_WIDTH * decoder->height / decoder->width);
+	if (height < 1)
+		height = 1;
+
+	rgba = bmalloc((size_t)ANALYSIS_WIDTH * (size_t)height * 4);
+	packet = av_packet_alloc();
+	frame = av_frame_alloc();
+
+	const double time_base = av_q2d(stream->time_base) * 1000.0;
+	const int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+	bool draining = false;
+	bool no_alpha = false;
+
+	while (!analysis_stopping && !no_alpha) {
+		if (!draining) {
+			int ret = av_read_frame(format, packet);
+			if (ret < 0) {
+				draining = true;
+				avcodec_send_packet(decoder, NULL);
+			} else {
+				if (packet->stream_index == index)
+					avcodec_send_packet(decoder, packet);
+				av_packet_unref(packet);
+			}
+		}
+
+		while (avcodec_receive_frame(decoder, frame) == 0) {
+			struct coverage_sample sample;
+
+			if (!measure_frame(frame, &sws, rgba, height, &sample.coverage)) {
+				no_alpha = true;
+				av_frame_unref(frame);
+				break;
+			}
+
+			int64_t pts = frame->best_effort_timestamp;
+			sample.ms = pts != AV_NOPTS_VALUE ? (double)(pts - start) * time_base
+							  : (samples.num ? samples.array[samples.num - 1].ms : 0.0);
+			da_push_back(samples, &sample);
+			av_frame_unref(frame);
+		}
+
+		if (draining)
+			break;
+	}
+
+	if (analysis_stopping)
+		goto done;
+
+	// Opaque media is still a valid (negative) result so it is not re-decoded
+	success = true;
+	if (format->duration != AV_NOPTS_VALUE)
+		result->duration_ms = (double)format->duration * 1000.0 / AV_TIME_BASE;
+	else if (samples.num)
+		result->duration_ms = samples.array[samples.num - 1].ms;
+
+	if (no_alpha || !samples.num)
+		goto done;
+
+	float best = 0.0f;
+	for (size_t i = 0; i < samples.num; i++) {
+		if (samples.array[i].coverage > best)
+			best = samples.array[i].coverage;
+	}
+
+	size_t first = 0;
+	while (samples.array[first].coverage < best - COVERAGE_TOLERANCE)
+		first++;
+	size_t last = first;
+	while (last + 1 < samples.num && samples.array[last + 1].coverage >= best - COVERAGE_TOLERANCE)
+		last++;
+
+	result->has_alpha = true;
+	result->peak_coverage = best;
+	result->peak_ms = (samples.array[first].ms + samples.array[last].ms) * 0.5;
+
+done:
+	da_free(samples);
+	bfree(rgba);
+	sws_freeContext(sws);
+	av_frame_free(&frame);
+	av_packet_free(&packet);
+	avcodec_free_context(&decoder);
+	avformat_close_input(&format);
+	return success;
+}
+#else
+// Built without FFmpeg, nothing is queued so this is never reached
+static bool analyse_file(const char *path, struct stinger_analysis *result)
+{
+	UNUSED_PARAMETER(path);
+	memset(result, 0, sizeof(*result));
+	return false;
+}
+#endif
+
+static void notify_waiters(struct analysis_job *job, bool success)
+{
+	for (size_t i = 0; i < job->waiters.num; i++)
+		job->waiters.array[i].done(job->waiters.array[i].param, success);
+	da_free(job->waiters);
+	bfree(job->path);
+}
+
+static void *analysis_thread_main(void *data)
+{
+	UNUSED_PARAMETER(data);
+	os_set_thread_name("scene-as-transition: stinger analysis");
+
+	while (os_sem_wait(analysis_sem) == 0) {
+		if (analysis_stopping)
+			break;
+
+		pthread_mutex_lock(&index_mutex);
+		if (!pending_jobs.num) {
+			pthread_mutex_unlock(&index_mutex);
+			continue;
+		}
+		running_job = pending_jobs.array[0];
+		da_erase(pending_jobs, 0);
+		const char *path = running_job.path;
+		pthread_mutex_unlock(&index_mutex);
+
+		// The file may have been analysed since it was queued
+		struct stinger_analysis result;
+		bool success = stinger_analysis_lookup(path, &result);
+
+		int64_t mtime, size;
+		if (!success && get_file_key(path, &mtime, &size)) {
+			uint64_t start = os_gettime_ns();
+			bool analysed = analyse_file(path, &result);
+
+			if (analysed) {
+				blog(LOG_INFO,
+				     "[StreamUP Scene as Transition] Analysed '%s' in %.0f ms: %s, peak coverage %.1f%% at %.0f ms",
+				     path, (double)(os_gettime_ns() - start) / 1000000.0,
+				     result.has_alpha ? "has alpha" : "opaque", result.peak_coverage * 100.0f,
+				     result.peak_ms);
+			} else if (!analysis_stopping) {
+				blog(LOG_WARNING,
+				     "[StreamUP Scene as Transition] Failed to analyse stinger media '%s', "
+				     "it is skipped until the file changes",
+				     path);
+			}
+
+			// Files that cannot be decoded are stored as opaque so
+			// they are not opened again for every update
+			if (!analysis_stopping) {
+				pthread_mutex_lock(&index_mutex);
+				struct index_entry *entry = find_entry(path);
+				if (!entry) {
+					entry = da_push_back_new(index_entries);
+					entry->path = bstrdup(path);
+				}
+				entry->mtime = mtime;
+				entry->size = size;
+				entry->result = result;
+				save_index();
+				pthread_mutex_unlock(&index_mutex);
+				success = true;
+			}
+		}
+
+		pthread_mutex_lock(&index_mutex);
+		struct analysis_job job = running_job;
+		memset(&running_job, 0, sizeof(running_job));
+		pthread_mutex_unlock(&index_mutex);
+
+		notify_waiters(&job, success);
+	}
+
+	return NULL;
+}
+
+void stinger_analysis_init(void)
+{
+	da_init(index_entries);
+	da_init(pending_jobs);
+	pthread_mutex_init(&index_mutex, NULL);
+	os_sem_init(&analysis_sem, 0);
+	load_index();
+}
+
+void stinger_analysis_free(void)
+{
+	if (analysis_thread_created) {
+		analysis_stopping = true;
+		os_sem_post(analysis_sem);
+		pthread_join(analysis_thread, NULL);
+		analysis_thread_created = false;
+	}
+
+	for (size_t i = 0; i < pending_jobs.num; i++)
+		notify_waiters(&pending_jobs.array[i], false);
+	da_free(pending_jobs);
+
+	for (size_t i = 0; i < index_entries.num; i++)
+		bfree(index_entries.array[i].path);
+	da_free(index_entries);
+
+	os_sem_destroy(analysis_sem);
+	analysis_sem = NULL;
+	pthread_mutex_destroy(&index_mutex);
+}
+
+bool stinger_analysis_lookup(const char *path, struct stinger_analysis *result)
+{
+	int64_t mtime, size;
+	if (!get_file_key(path, &mtime, &size))
+		return false;
+
+	bool found = false;
+	pthread_mutex_lock(&index_mutex);
+	struct index_entry *entry = find_entry(path);
+	if (entry && entry->mtime == mtime && entry->size == size) {
+		*result = entry->result;
+		found = true;
+	}
+	pthread_mutex_unlock(&index_mutex);
+	return found;
+}
+
+bool stinger_analysis_available(void)
+{
+#ifdef ENABLE_STINGER_ANALYSIS
+	return true;
+#else
+	return false;
+#endif
+}
+
+void stinger_analysis_queue(const char *path, stinger_analysis_done_t done, void *param)
+{
+	if (!stinger_analysis_available()) {
+		done(param, false);
+		return;
+	}
+
+	struct analysis_waiter waiter = {done, param};
+	struct analysis_job *job = NULL;
+
+	pthread_mutex_lock(&index_mutex);
+	if (running_job.path && strcmp(running_job.path, path) == 0)
+		job = &running_job;
+	for (size_t i = 0; !job && i < pending_jobs.num; i++) {
+		if (strcmp(pending_jobs.array[i].path, path) == 0)
+			job = &pending_jobs.array[i];
+	}
+
+	const bool new_job = !job;
+	if (new_job) {
+		if (!analysis_thread_created && !analysis_stopping)
+			analysis_thread_created =
+				pthread_create(&analysis_thread, NULL, analysis_thread_main, NULL) == 0;
+
+		job = da_push_back_new(pending_jobs);
+		job->path = bstrdup(path);
+	}
+	da_push_back(job->waiters, &waiter);
+	pthread_mutex_unlock(&index_mutex);
+
+	if (new_job)
+		os_sem_post(analysis_sem);
+}
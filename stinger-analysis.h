@@ -0,0 +1,37 @@
+#pragma once
+
+#include "obs-module.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct stinger_analysis {
+	bool has_alpha;
+	double duration_ms;
+	// Middle of the first run of frames with the highest alpha coverage
+	double peak_ms;
+	float peak_coverage;
+};
+
+// Called exactly once per queued file, for every caller that queued it. On
+// success the result can be read with stinger_analysis_lookup, files that
+// could not be decoded are stored as opaque. Cancelled jobs and builds
+// without FFmpeg report success = false.
+typedef void (*stinger_analysis_done_t)(void *param, bool success);
+
+void stinger_analysis_init(void);
+void stinger_analysis_free(void);
+
+// False when the plugin was built without FFmpeg
+bool stinger_analysis_available(void);
+
+// Cache lookup only, never decodes. Entries are keyed by path, mtime and size.
+bool stinger_analysis_lookup(const char *path, struct stinger_analysis *result);
+
+// Queue a file to be decoded on the analysis thread.
+void stinger_analysis_queue(const char *path, stinger_analysis_done_t done, void *param);
+
+#ifdef __cplusplus
+}
+#endif
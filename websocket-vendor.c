@@ -0,0 +1,187 @@
+#include "obs-module.h"
+#include "websocket-vendor.h"
+#include <obs-frontend-api.h>
+
+#define VENDOR_NAME "streamup-scene-as-transition"
+
+// Minimal binding to the obs-websocket vendor API, which is exposed through
+// a proc handler so there is nothing to link against
+typedef void (*vendor_request_callback_t)(obs_data_t *request, obs_data_t *response, void *priv_data);
+
+struct vendor_request_callback {
+	vendor_request_callback_t callback;
+	void *priv_data;
+};
+
+static proc_handler_t *websocket_ph = NULL;
+
+static void *register_vendor(const char *name)
+{
+	calldata_t cd = {0};
+
+	if (!proc_handler_call(obs_get_proc_handler(), "obs_websocket_api_get_ph", &cd)) {
+		calldata_free(&cd);
+		return NULL;
+	}
+	websocket_ph = calldata_ptr(&cd, "ph");
+	calldata_free(&cd);
+	if (!websocket_ph)
+		return NULL;
+
+	calldata_init(&cd);
+	calldata_set_string(&cd, "name", name);
+	proc_handler_call(websocket_ph, "vendor_register", &cd);
+	void *vendor = calldata_ptr(&cd, "vendor");
+	calldata_free(&cd);
+	return vendor;
+}
+
+static bool register_request(void *vendor, const char *type, vendor_request_callback_t callback)
+{
+	struct vendor_request_callback cb = {callback, NULL};
+	calldata_t cd = {0};
+
+	calldata_set_ptr(&cd, "vendor", vendor);
+	calldata_set_string(&cd, "type", type);
+	calldata_set_ptr(&cd, "callback", &cb);
+	proc_handler_call(websocket_ph, "vendor_request_register", &cd);
+	bool success = calldata_bool(&cd, "success");
+	calldata_free(&cd);
+
+	if (!success)
+		blog(LOG_WARNING, "[StreamUP Scene as Transition] Failed to register websocket request '%s'", type);
+	return success;
+}
+
+static obs_source_t *find_transition(const char *name)
+{
+	struct obs_frontend_source_list transitions = {0};
+	obs_source_t *found = NULL;
+
+	obs_frontend_get_transitions(&transitions);
+	for (size_t i = 0; i < transitions.sources.num; i++) {
+		obs_source_t *transition = transitions.sources.array[i];
+		if (strcmp(obs_source_get_unversioned_id(transition), "scene_as_transition") == 0 &&
+		    strcmp(obs_source_get_name(transition), name) == 0) {
+			found = obs_source_get_ref(transition);
+			break;
+		}
+	}
+	obs_frontend_source_list_free(&transitions);
+	return found;
+}
+
+static obs_source_t *get_request_transition(obs_data_t *request, obs_data_t *response)
+{
+	const char *name = obs_data_get_string(request, "transitionName");
+	obs_source_t *transition = find_transition(name);
+	if (!transition) {
+		obs_data_set_bool(response, "success", false);
+		obs_data_set_string(response, "error", "No Scene As Transition with that transitionName was found.");
+	}
+	return transition;
+}
+
+static void prearm_request(obs_data_t *request, obs_data_t *response, void *priv_data)
+{
+	UNUSED_PARAMETER(priv_data);
+	obs_source_t *transition = get_request_transition(request, response);
+	if (!transition)
+		return;
+
+	calldata_t cd = {0};
+	calldata_set_int(&cd, "timeout_ms", obs_data_get_int(request, "timeoutMs"));
+	proc_handler_call(obs_source_get_proc_handler(transition), "prearm", &cd);
+	obs_data_set_bool(response, "success", calldata_bool(&cd, "success"));
+	calldata_free(&cd);
+
+	obs_source_release(transition);
+}
+
+static void disarm_request(obs_data_t *request, obs_data_t *response, void *priv_data)
+{
+	UNUSED_PARAMETER(priv_data);
+	obs_source_t *transition = get_request_transition(request, response);
+	if (!transition)
+		return;
+
+	calldata_t cd = {0};
+	proc_handler_call(obs_source_get_proc_handler(transition), "disarm", &cd);
+	obs_data_set_bool(response, "success", true);
+	calldata_free(&cd);
+
+	obs_source_release(transition);
+}
+
+static const struct {
+	const char *proc_name;
+	const char *json_name;
+} stats_fields[] = {
+	{"transitions", "transitions"},
+	{"last_activation_ns", "lastActivationNs"},
+	{"last_render_ns", "lastRenderNs"},
+	{"max_render_ns", "maxRenderNs"},
+	{"avg_render_ns", "avgRenderNs"},
+	{"dropped_frames", "droppedFrames"},
+	{"last_dropped_frames", "lastDroppedFrames"},
+};
+
+static void get_stats_request(obs_data_t *request, obs_data_t *response, void *priv_data)
+{
+	UNUSED_PARAMETER(priv_data);
+	obs_source_t *transition = get_request_transition(request, response);
+	if (!transition)
+		return;
+
+	calldata_t cd = {0};
+	proc_handler_call(obs_source_get_proc_handler(transition), "get_stats", &cd);
+	for (size_t i = 0; i < sizeof(stats_fields) / sizeof(stats_fields[0]); i++)
+		obs_data_set_int(response, stats_fields[i].json_name, calldata_int(&cd, stats_fields[i].proc_name));
+	obs_data_set_bool(response, "prearmed", calldata_bool(&cd, "prearmed"));
+	obs_data_set_bool(response, "success", true);
+	calldata_free(&cd);
+
+	obs_source_release(transition);
+}
+
+static void get_transition_list_request(obs_data_t *request, obs_data_t *response, void *priv_data)
+{
+	UNUSED_PARAMETER(request);
+	UNUSED_PARAMETER(priv_data);
+
+	struct obs_frontend_source_list transitions = {0};
+	obs_data_array_t *names = obs_data_array_create();
+
+	obs_frontend_get_transitions(&transitions);
+	for (size_t i = 0; i < transitions.sources.num; i++) {
+		obs_source_t *transition = transitions.sources.array[i];
+		if (strcmp(obs_source_get_unversioned_id(transition), "scene_as_transition") != 0)
+			continue;
+
+		obs_data_t *item = obs_data_create();
+		obs_data_set_string(item, "transitionName", obs_source_get_name(transition));
+		obs_data_array_push_back(names, item);
+		obs_data_release(item);
+	}
+	obs_frontend_source_list_free(&transitions);
+
+	obs_data_set_array(response, "transitions", names);
+	obs_data_set_bool(response, "success", true);
+	obs_data_array_release(names);
+}
+
+void websocket_vendor_register(void)
+{
+	void *vendor = register_vendor(VENDOR_NAME);
+	if (!vendor) {
+		blog(LOG_INFO, "[StreamUP Scene as Transition] obs-websocket not found, vendor requests disabled");
+		return;
+	}
+
+	register_request(vendor, "GetTransitionList", get_transition_list_request);
+	register_request(vendor, "PrearmTransition", prearm_request);
+	register_request(vendor, "DisarmTransition", disarm_request);
+	register_request(vendor, "GetTransitionStats", get_stats_request);
+
+	blog(LOG_INFO, "[StreamUP Scene as Transition] Registered obs-websocket vendor '%s'", VENDOR_NAME);
+}
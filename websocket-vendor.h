@@ -0,0 +1,13 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Registers the obs-websocket vendor requests, does nothing when
+// obs-websocket is not installed. Call from obs_module_post_load.
+void websocket_vendor_register(void);
+
+#ifdef __cplusplus
+}
+#endif